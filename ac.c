@@ -0,0 +1,204 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ac.h"
+#include "err.h"
+
+static unsigned char fold(const unsigned char);
+
+/*
+ * Fold an ASCII letter to lowercase.
+ */
+static unsigned char
+fold(const unsigned char c)
+{
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/*
+ * Build an automaton a that finds the 'n' null-terminated words at words.
+ * Empty words are left out, and a word that is given twice is only found once.
+ * If icase is nonzero, ASCII letters match regardless of case. Returns 0, or
+ * -1 if there are no words to find, in which case a is left empty.
+ */
+int
+ac_build(Automaton *const a, char *const *const words, const int n,
+		const int icase)
+{
+	const unsigned char *w;
+	int *fail, *queue;
+	int i, c, s, t, nc, head, tail, maxstates;
+	size_t size;
+
+	memset(a, 0, sizeof(*a));
+
+	/* Give each byte that is in a word a class of its own. */
+	a->nclasses = 1;
+	maxstates = 1;
+	for (i = 0; i < n; i++) {
+		for (w = (const unsigned char *)words[i]; *w != '\0'; w++) {
+			c = icase ? fold(*w) : *w;
+			if (a->class[c] == 0)
+				a->class[c] = a->nclasses++;
+			maxstates++;
+		}
+	}
+	if (maxstates == 1)
+		return -1;
+	if (icase)
+		for (c = 'A'; c <= 'Z'; c++)
+			a->class[c] = a->class[fold(c)];
+	nc = a->nclasses;
+
+	size = (size_t)maxstates * nc;
+	if ((a->next = calloc(size, sizeof(*a->next))) == NULL ||
+			(a->len = calloc(maxstates, sizeof(*a->len))) == NULL ||
+			(a->count = calloc(maxstates, sizeof(*a->count))) ==
+			NULL)
+		err(EXIT_FAILURE, "calloc failed");
+
+	/* Put the words in a trie. No transition of the trie leads back to
+	 * the start, so 0 stands for one that is missing.
+	 */
+	a->nstates = 1;
+	for (i = 0; i < n; i++) {
+		s = 0;
+		for (w = (const unsigned char *)words[i]; *w != '\0'; w++) {
+			c = a->class[*w];
+			if ((t = a->next[s * nc + c]) == 0) {
+				t = a->nstates++;
+				a->next[s * nc + c] = t;
+			}
+			s = t;
+		}
+		if (s != 0 && a->count[s] == 0) {
+			a->count[s] = 1;
+			a->len[s] = w - (const unsigned char *)words[i];
+		}
+	}
+
+	if ((fail = malloc(sizeof(*fail) * a->nstates)) == NULL ||
+			(queue = malloc(sizeof(*queue) * a->nstates)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	/* Visit the states breadth-first, so that the state that each one
+	 * fails to, which is shallower, is complete before it is. A missing
+	 * transition is replaced with the one from the state it fails to.
+	 */
+	head = tail = 0;
+	for (c = 0; c < nc; c++) {
+		if ((t = a->next[c]) != 0) {
+			fail[t] = 0;
+			queue[tail++] = t;
+		}
+	}
+	while (head < tail) {
+		s = queue[head++];
+
+		/* The words that end in the state it fails to end here too,
+		 * but they are shorter than one that ends here.
+		 */
+		a->count[s] += a->count[fail[s]];
+		if (a->len[s] == 0)
+			a->len[s] = a->len[fail[s]];
+
+		for (c = 0; c < nc; c++) {
+			if ((t = a->next[s * nc + c]) != 0) {
+				fail[t] = a->next[fail[s] * nc + c];
+				queue[tail++] = t;
+			} else {
+				a->next[s * nc + c] = a->next[fail[s] * nc + c];
+			}
+		}
+	}
+
+	free(fail);
+	free(queue);
+
+	/* There are fewer states than bytes when words share prefixes. */
+	if ((a->next = realloc(a->next,
+			sizeof(*a->next) * a->nstates * nc)) == NULL)
+		err(EXIT_FAILURE, "realloc failed");
+
+	return 0;
+}
+
+/*
+ * Find the words of a in the 'length' bytes at text. The spans of text that
+ * they cover are stored in order in a new array at *spans, with words that
+ * overlap or touch in one span, and how many spans there are at *amt. Returns
+ * the amount of words found, counting every one, even those inside of
+ * others.
+ */
+long
+ac_find(const Automaton *const a, const char *const text, const long length,
+		Span **const spans, long *const amt)
+{
+	const int nc = a->nclasses;
+	long i, start, hits, size;
+	int s;
+
+	*spans = NULL;
+	*amt = size = 0;
+	hits = 0;
+
+	for (i = 0, s = 0; i < length; i++) {
+		s = a->next[s * nc + a->class[(unsigned char)text[i]]];
+		if (a->count[s] == 0)
+			continue;
+
+		hits += a->count[s];
+
+		/* The longest word that ends here covers any shorter ones that
+		 * do, but it may start before spans that were already found.
+		 */
+		start = i + 1 - a->len[s];
+		while (*amt > 0 && start <= (*spans)[*amt - 1].end) {
+			(*amt)--;
+			if ((*spans)[*amt].start < start)
+				start = (*spans)[*amt].start;
+		}
+
+		if (*amt == size) {
+			size = size == 0 ? 64 : size * 2;
+			if ((*spans = realloc(*spans, sizeof(**spans) * size))
+					== NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		(*spans)[*amt].start = start;
+		(*spans)[*amt].end = i + 1;
+		(*amt)++;
+	}
+
+	return hits;
+}
+
+/*
+ * Free the memory of a.
+ */
+void
+ac_free(Automaton *const a)
+{
+	free(a->next);
+	free(a->len);
+	free(a->count);
+	memset(a, 0, sizeof(*a));
+}
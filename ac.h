@@ -0,0 +1,62 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef AC_H
+#define AC_H
+
+/*
+ * A span of text, from start up to but not including end.
+ */
+typedef struct {
+	long start, end;
+} Span;
+
+/*
+ * An Aho-Corasick automaton, which finds every one of a list of words in a
+ * text in a single pass over it, however many words there are.
+ *
+ * The failure links of the automaton are folded into its transitions, so that
+ * each byte of text is one lookup in a table. To keep the table small, bytes
+ * are looked up by class: each byte that is in a word has a class of its own,
+ * and every other byte shares class 0.
+ */
+typedef struct {
+	/* The class of every byte. */
+	unsigned short class[256];
+	int nclasses;
+
+	/* The state after each class of byte in each state, nclasses to a
+	 * state. State 0 is the start.
+	 */
+	int *next;
+
+	/* For each state, the length of the longest word that ends there,
+	 * or 0 if none does, and how many words end there.
+	 */
+	int *len;
+	int *count;
+
+	int nstates;
+} Automaton;
+
+int ac_build(Automaton *const, char *const *const, const int, const int);
+long ac_find(const Automaton *const, const char *const, const long,
+		Span **const, long *const);
+void ac_free(Automaton *const);
+
+#endif /* AC_H */
@@ -0,0 +1,357 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/*
+ * Times the parts of navipage that have to keep up with large inputs, and
+ * prints how fast they are next to how fast they used to be. Run it with
+ * "make bench".
+ */
+
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "err.h"
+#include "filekey.h"
+#include "lines.h"
+#include "pool.h"
+
+/* How many files are sorted. */
+#define FILES 100000
+
+/* How many times each thing is timed. The fastest time is the one shown, as
+ * the others were slowed down by something else.
+ */
+#define RUNS 3
+
+/* How many megabytes of text are indexed, unless given as an argument. */
+#define TEXT_MB 256
+
+/* The most threads that lines are indexed on, at least, unless there are
+ * more cores than this.
+ */
+#define THREADS_MAX 8
+
+/* How many lines the old index grew by at a time. */
+#define ST_SIZE_INCR 10
+
+static void bench_index(const char *const, const long);
+static void bench_sort(const char *const);
+static void bench_threads(const char *const, const long);
+static long byte_index(const char *const, const long, const int);
+static int compare_path_basenames(const void *, const void *);
+static char *make_text(const long);
+static double now(void);
+static void report(const char *const, const double, const double,
+		const char *const);
+
+/*
+ * Time indexing the lines of the 'length' characters at text, the old way and
+ * with lines_index().
+ */
+static void
+bench_index(const char *const text, const long length)
+{
+	LineIndex li;
+	double t, best[3];
+	long amt;
+	int i, run;
+
+	memset(&li, 0, sizeof(li));
+	amt = 0;
+
+	for (i = 0; i < 3; i++)
+		best[i] = -1;
+	for (run = 0; run < RUNS; run++) {
+		for (i = 0; i < 2; i++) {
+			t = now();
+			amt = byte_index(text, length, i);
+			t = now() - t;
+			if (best[i] < 0 || t < best[i])
+				best[i] = t;
+		}
+
+		t = now();
+		lines_index(&li, text, length);
+		t = now() - t;
+		if (best[2] < 0 || t < best[2])
+			best[2] = t;
+		if (li.amt != amt) {
+			fprintf(stderr, "%s: lines_index found %d lines, "
+					"not %ld\n", argv0, li.amt, amt);
+			exit(EXIT_FAILURE);
+		}
+		free(li.wide ? (void *)li.v.wide : (void *)li.v.narrow);
+	}
+
+	printf("indexing %ld MB of %ld lines:\n", length >> 20, amt);
+	report("one byte at a time, grown by 10", best[0], length / 1e9,
+			"GB/s");
+	report("one byte at a time, doubled", best[1], length / 1e9, "GB/s");
+	report("lines_index()", best[2], length / 1e9, "GB/s");
+}
+
+/*
+ * Time sorting FILES paths the old way and with filekey_sort(), where every
+ * basename is the format fmt with a different number. The numbers are
+ * shuffled, and the files are in the same order both ways.
+ */
+static void
+bench_sort(const char *const fmt)
+{
+	FileKey *keys;
+	char **paths, **v, *swap, base[32], path[64];
+	double t, best[2];
+	unsigned long seed;
+	long r;
+	int i, run;
+
+	if ((paths = malloc(sizeof(*paths) * FILES)) == NULL ||
+			(v = malloc(sizeof(*v) * FILES)) == NULL ||
+			(keys = malloc(sizeof(*keys) * FILES)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	seed = 1;
+	for (i = 0; i < FILES; i++) {
+		seed = seed * 1103515245 + 12345;
+		r = (long)(seed >> 16 & 0x7fff) % (i + 1);
+		snprintf(base, sizeof(base), fmt, i);
+		snprintf(path, sizeof(path), "/home/user/videos/%s", base);
+		if ((swap = strdup(path)) == NULL)
+			err(EXIT_FAILURE, "strdup failed");
+
+		/* Put the new path at a random place among those before. */
+		paths[i] = paths[r];
+		paths[r] = swap;
+	}
+
+	best[0] = best[1] = -1;
+	for (run = 0; run < RUNS; run++) {
+		memcpy(v, paths, sizeof(*v) * FILES);
+		t = now();
+		qsort(v, FILES, sizeof(*v), compare_path_basenames);
+		t = now() - t;
+		if (best[0] < 0 || t < best[0])
+			best[0] = t;
+
+		t = now();
+		for (i = 0; i < FILES; i++)
+			filekey_init(&keys[i], paths[i]);
+		filekey_sort(keys, FILES);
+		t = now() - t;
+		if (best[1] < 0 || t < best[1])
+			best[1] = t;
+
+		for (i = 0; i < FILES; i++) {
+			if (keys[i].path != v[i]) {
+				fprintf(stderr, "%s: filekey_sort put %s where "
+						"%s was\n", argv0,
+						keys[i].path, v[i]);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	printf("sorting %d files named like %s:\n", FILES, base);
+	report("qsort() by strdup() and basename()", best[0], FILES / 1e6,
+			"M/s");
+	report("filekey_sort()", best[1], FILES / 1e6, "M/s");
+
+	for (i = 0; i < FILES; i++)
+		free(paths[i]);
+	free(keys);
+	free(v);
+	free(paths);
+}
+
+/*
+ * Time lines_index_threads() on the 'length' characters at text with more and
+ * more threads, up to THREADS_MAX or one for each core.
+ */
+static void
+bench_threads(const char *const text, const long length)
+{
+	LineIndex li;
+	char name[64];
+	double t, best, one;
+	int n, max, run;
+
+	memset(&li, 0, sizeof(li));
+	max = pool_cores() > THREADS_MAX ? pool_cores() : THREADS_MAX;
+	one = 0;
+
+	printf("indexing %ld MB on threads, with %d cores online:\n",
+			length >> 20, pool_cores());
+	for (n = 1; n <= max; n *= 2) {
+		best = -1;
+		for (run = 0; run < RUNS; run++) {
+			t = now();
+			lines_index_threads(&li, text, length, n);
+			t = now() - t;
+			if (best < 0 || t < best)
+				best = t;
+			free(li.wide ? (void *)li.v.wide :
+					(void *)li.v.narrow);
+		}
+		if (n == 1)
+			one = best;
+
+		snprintf(name, sizeof(name), "%d thread%s, %.2fx", n,
+				n == 1 ? "" : "s", one / best);
+		report(name, best, length / 1e9, "GB/s");
+	}
+}
+
+/*
+ * Index the lines of the 'length' characters at text as init_buffer() used
+ * to: one character at a time, into an array of pointers that grows by
+ * ST_SIZE_INCR pointers whenever it is full, or that doubles if doubling is
+ * nonzero. Returns how many lines there are.
+ */
+static long
+byte_index(const char *const text, const long length, const int doubling)
+{
+	const char **st;
+	long i, amt, size;
+
+	size = ST_SIZE_INCR;
+	if ((st = malloc(sizeof(*st) * size)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	st[0] = text;
+	amt = 1;
+
+	for (i = 1; i < length; i++) {
+		if (text[i - 1] != '\n')
+			continue;
+
+		while (size <= amt) {
+			size = doubling ? size * 2 : size + ST_SIZE_INCR;
+			if ((st = realloc(st, sizeof(*st) * size)) == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+
+		st[amt++] = &text[i];
+	}
+
+	free(st);
+
+	return amt;
+}
+
+/*
+ * Compare the paths at p1 and p2 as main() used to sort files: by the
+ * basenames of copies of them, in descending order.
+ */
+static int
+compare_path_basenames(const void *p1, const void *p2)
+{
+	const char **strp1 = (const char **)p1, **strp2 = (const char **)p2;
+	char *copy1, *copy2;
+	int ret;
+
+	copy1 = strdup(*strp1);
+	copy2 = strdup(*strp2);
+	if (copy1 == NULL || copy2 == NULL)
+		err(EXIT_FAILURE, "strdup failed");
+
+	ret = -strcmp(basename(copy1), basename(copy2));
+
+	free(copy1);
+	free(copy2);
+
+	return ret;
+}
+
+/*
+ * Return 'length' characters of text, in lines of up to 120 characters. The
+ * text is the same every time.
+ */
+static char *
+make_text(const long length)
+{
+	char *text;
+	unsigned long seed;
+	long i, end;
+
+	if ((text = malloc(length)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	seed = 1;
+	for (i = 0; i < length; i = end + 1) {
+		seed = seed * 1103515245 + 12345;
+		end = i + (long)(seed >> 16 & 0x7fff) % 120;
+		if (end >= length)
+			end = length - 1;
+		memset(text + i, 'x', end - i);
+		text[end] = '\n';
+	}
+
+	return text;
+}
+
+/*
+ * Return the time in seconds on a clock that only ever goes forward.
+ */
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Print that what was timed, named name, took 'secs' seconds to go through
+ * 'amt' of what unit is the rate of.
+ */
+static void
+report(const char *const name, const double secs, const double amt,
+		const char *const unit)
+{
+	printf("  %-40s %8.3f s %8.2f %s\n", name, secs, amt / secs, unit);
+}
+
+int
+main(int argc, char *argv[])
+{
+	char *text;
+	long mb;
+
+	argv0 = argv[0];
+
+	mb = argc > 1 ? atol(argv[1]) : TEXT_MB;
+	if (mb < 1) {
+		fprintf(stderr, "usage: %s [megabytes]\n", argv0);
+		return EXIT_FAILURE;
+	}
+
+	text = make_text(mb << 20);
+	bench_index(text, mb << 20);
+	bench_threads(text, mb << 20);
+	free(text);
+
+	bench_sort("%08d");
+	bench_sort("video-%d.txt");
+
+	return EXIT_SUCCESS;
+}
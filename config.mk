@@ -7,10 +7,23 @@ MANPREFIX = $(PREFIX)/share/man
 
 #includes and libs
 INCS = -I$(PREFIX)/include
-LIBS = -lreadline
+LIBS = -lreadline -lpthread
+
+# files at least this many bytes long are line-indexed on every core at once
+PARALLEL_INDEX_MIN = 67108864
+
+# files at least this many bytes long have their line index cached on disk,
+# and the cache is kept under this many bytes, dropping the least recently used
+CACHE_INDEX_MIN = 1048576
+CACHE_INDEX_MAX = 268435456
+
+# set to 0 to stop wrapping each frame in synchronized update escape sequences
+SYNC_UPDATE = 1
 
 # flags
-CPPFLAGS = $(INCS) -D_POSIX_C_SOURCE=200809L -DVERSION=\"$(VERSION)\"
+CPPFLAGS = $(INCS) -D_POSIX_C_SOURCE=200809L -DVERSION=\"$(VERSION)\" \
+	-DLINES_PARALLEL_MIN=$(PARALLEL_INDEX_MIN)L -DSYNC_UPDATE=$(SYNC_UPDATE) \
+	-DLINES_CACHE_MIN=$(CACHE_INDEX_MIN)L -DLINES_CACHE_MAX=$(CACHE_INDEX_MAX)L
 CFLAGS = -std=c99 -Wall -Wextra -Wpedantic
 LDFLAGS = -L$(PREFIX)/lib $(LIBS)
 ifdef DEBUG
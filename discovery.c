@@ -0,0 +1,258 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "discovery.h"
+#include "err.h"
+#include "filekey.h"
+#include "loader.h"
+#include "navipage.h"
+#include "pool.h"
+#include "results.h"
+#include "walk.h"
+
+/* How many files there is first room for in filel, and buffers in bufl. */
+#define FILEL_SIZE_INIT 64
+
+/* How many bytes of paths each block of filel has room for, unless a path is
+ * longer. See add_file().
+ */
+#define PATH_BLOCK_SIZE 65536
+
+enum add_path_recurse_argument {
+	NO_RECURSE = 0,
+	RECURSE = 1
+};
+
+static void add_file(const char *const, void *);
+static int add_path(const char *const, const int);
+static void found_file(const char *const, void *);
+
+Discovery discovery = {
+	PTHREAD_MUTEX_INITIALIZER,
+	NULL, NULL, 0, NULL,
+	{ 0, 0, NULL, NULL, 0 },
+	0, 0
+};
+
+/*
+ * Append the regular file at path to the FileList at arg.
+ */
+static void
+add_file(const char *const path, void *arg)
+{
+	FileList *const l = arg;
+	const size_t len = strlen(path) + 1;
+
+	/* Double the space for pointers whenever it runs out, so that adding
+	 * a path takes constant time on average.
+	 */
+	if (l->amt == l->size) {
+		l->size = l->size == 0 ? FILEL_SIZE_INIT :
+			l->size * 2;
+		if ((l->v = realloc(l->v, sizeof(*l->v) *
+						l->size)) == NULL)
+			err(EXIT_FAILURE, "realloc failed");
+	}
+
+	/* Start a new block once the path does not fit in what is left of
+	 * the last one.
+	 */
+	if (len > l->left) {
+		l->left = len > PATH_BLOCK_SIZE ? len : PATH_BLOCK_SIZE;
+		if ((l->block = malloc(l->left)) == NULL)
+			err(EXIT_FAILURE, "malloc failed");
+	}
+
+	/* Add the file path! */
+	memcpy(l->block, path, len);
+	l->v[l->amt++] = l->block;
+	l->block += len;
+	l->left -= len;
+}
+
+/*
+ * Hand the file at path to the main thread, through found_file(). If path is a
+ * directory, and recurse is nonzero, then all files in path will be handed
+ * over through walk(). Return value shall be 0 on success, and -1 on error. Upon
+ * irreconciliable errors, such as running out of memory, the program shall be
+ * exited with code EXIT_FAILURE.
+ */
+static int
+add_path(const char *path, const int recurse)
+{
+	struct stat statbuf;
+
+	if (stat(path, &statbuf) == -1)
+		return (ewarn("cannot stat %s", path), -1);
+
+	if (S_ISDIR(statbuf.st_mode))
+		return recurse ? walk(path, discovery.pool, found_file, NULL) :
+			(warn("no -r; omitting directory %s\n", path), -1);
+
+	if (!S_ISREG(statbuf.st_mode))
+		return (warn("cannot read %s: not a regular file\n", path), -1);
+
+	found_file(path, NULL);
+
+	return 0;
+}
+
+/*
+ * The body of the thread that finds the files to be read, by walking
+ * discovery.dir and then discovery.paths. It hands them to the main thread
+ * through found_file() as it goes.
+ */
+void *
+discover(void *arg)
+{
+	int i;
+
+	(void)arg;
+
+	if (discovery.dir != NULL)
+		add_path(discovery.dir, RECURSE);
+	for (i = 0; i < discovery.amt; i++)
+		add_path(discovery.paths[i], flags.recurse_more);
+
+	pthread_mutex_lock(&discovery.lock);
+	discovery.done = 1;
+	pthread_mutex_unlock(&discovery.lock);
+	wake_up();
+
+	return NULL;
+}
+
+/*
+ * Hand the regular file at path to the main thread, which takes it with
+ * take_files(). This has the signature that walk() calls it with; arg is
+ * unused.
+ */
+static void
+found_file(const char *const path, void *arg)
+{
+	int first;
+
+	(void)arg;
+
+	pthread_mutex_lock(&discovery.lock);
+	first = discovery.found.amt == 0;
+	add_file(path, &discovery.found);
+	pthread_mutex_unlock(&discovery.lock);
+
+	/* The main thread only needs to be woken up once for all the files
+	 * found before it takes them.
+	 */
+	if (first)
+		wake_up();
+}
+
+/*
+ * Insert the files found since this was last called into their sorted places
+ * in bufl and filel. Until the user moves to another buffer, the first one,
+ * which is of the newest file found so far, is kept open; after, the buffer
+ * that was open is kept open. Returns nonzero if anything changed.
+ */
+int
+take_files(void)
+{
+	FileKey *keys;
+	Buffer *cur, *b;
+	char *path;
+	pthread_t thread;
+	int amt, done, i, j, k, size;
+
+	if (discovery.settled)
+		return 0;
+
+	pthread_mutex_lock(&discovery.lock);
+	amt = discovery.found.amt;
+	done = discovery.done;
+	if ((keys = malloc(sizeof(*keys) * (amt + 1))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	for (i = 0; i < amt; i++)
+		filekey_init(&keys[i], discovery.found.v[i]);
+	discovery.found.amt = 0;
+	pthread_mutex_unlock(&discovery.lock);
+
+	filekey_sort(keys, amt);
+
+	/* Double the space for buffers whenever it runs out. */
+	if (bufl.amt + amt > bufl.size) {
+		size = bufl.size == 0 ? FILEL_SIZE_INIT : bufl.size;
+		while (size < bufl.amt + amt)
+			size *= 2;
+		if ((bufl.v = realloc(bufl.v, sizeof(*bufl.v) * size)) ==
+				NULL ||
+				(filel.v = realloc(filel.v,
+						sizeof(*filel.v) * size)) == NULL)
+			err(EXIT_FAILURE, "realloc failed");
+		bufl.size = filel.size = size;
+	}
+
+	/* Merge the new files in from the back, so that each buffer is moved
+	 * at most once.
+	 */
+	cur = bufl.amt > 0 ? bufl.v[bufl.n] : NULL;
+	i = bufl.amt - 1;
+	j = amt - 1;
+	for (k = bufl.amt + amt - 1; j >= 0; k--) {
+		if (i >= 0 && filekey_compare(&bufl.v[i]->key, &keys[j]) > 0) {
+			b = bufl.v[i--];
+		} else {
+			if ((b = calloc(1, sizeof(*b))) == NULL)
+				err(EXIT_FAILURE, "calloc failed");
+			b->key = keys[j--];
+		}
+		bufl.v[k] = b;
+		filel.v[k] = b->key.path;
+		if (b == cur)
+			bufl.n = k;
+	}
+	bufl.amt += amt;
+	filel.amt = bufl.amt;
+	free(keys);
+
+	if (!bufl.moved && bufl.amt > 0 && bufl.v[0] != cur) {
+		bufl.n = 0;
+		load_buffer(0);
+	}
+
+	if (done) {
+		discovery.settled = 1;
+
+		if (flags.all)
+			load_all_buffers();
+
+		/* Keep a trigram index of $NAVIPAGE_DIR, for searches of
+		 * every buffer. It is brought up to date in the background.
+		 */
+		if (indexed && (path = cache_path("trigrams")) != NULL) {
+			if (pthread_create(&thread, NULL, index_files, path) !=
+					0)
+				err(EXIT_FAILURE, "cannot pthread_create");
+			pthread_detach(thread);
+		}
+	}
+
+	return amt > 0 || done;
+}
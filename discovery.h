@@ -0,0 +1,67 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+#include <pthread.h>
+
+#include "navipage.h"
+#include "pool.h"
+
+/*
+ * Finds the files to be read on a thread of its own, so that the first of them
+ * can be shown before the rest are found. See discover().
+ */
+typedef struct {
+	/* Guards found and done. */
+	pthread_mutex_t lock;
+
+	/* The directory to walk first, or NULL, and the paths to add after
+	 * it.
+	 */
+	const char *dir;
+	char **paths;
+	int amt;
+
+	/* The worker threads that directories are read on. These are not the
+	 * loader's, so that a buffer being read ahead is never queued behind
+	 * the directories of a walk. See walk().
+	 */
+	Pool *pool;
+
+	/* The files found since the main thread last took them with
+	 * take_files().
+	 */
+	FileList found;
+
+	/* Whether every file has been found. */
+	int done;
+
+	/* Whether the main thread has taken every file. This is only used by
+	 * the main thread, and needs no lock.
+	 */
+	int settled;
+} Discovery;
+
+extern Discovery discovery;
+
+void *discover(void *);
+int take_files(void);
+
+#endif /* DISCOVERY_H */
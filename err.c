@@ -10,7 +10,7 @@
 
 /**
  * @file err.c
- * @version 1.1.0
+ * @version 1.2.0
  * @brief Main source code file
  * @details This file contains definitions and declarations of globally
  * available functions and variables.
@@ -25,23 +25,54 @@
 #include "err.h"
 
 char *argv0;
+void (*warn_hook)(const char *);
 
 /**
- * @details Prints argv0, ": ", and the printf(3)-like-formatted error message.
+ * @details Prints argv0, ": ", and the printf(3)-like-formatted error message,
+ * or passes them to warn_hook if it is set.
  */
 void
 vwarn(const char *fmt, va_list ap)
 {
+	char buf[BUFSIZ];
+	int n;
+
+	if (warn_hook != NULL) {
+		n = snprintf(buf, sizeof(buf), "%s: ", argv0);
+		vsnprintf(buf + n, sizeof(buf) - n, fmt, ap);
+		warn_hook(buf);
+		return;
+	}
+
 	fprintf(stderr, "%s: ", argv0);
 	vfprintf(stderr, fmt, ap);
 }
 
 /**
  * @details Calls vwarn(), then prints ": ", strerror(errno), and a newline.
+ * If warn_hook is set, these are all passed to it at once.
  */
 void
 vewarn(const char *fmt, va_list ap)
 {
+	char buf[BUFSIZ];
+	const int e = errno;
+	int n;
+
+	if (warn_hook != NULL) {
+		n = snprintf(buf, sizeof(buf), "%s: ", argv0);
+		n += vsnprintf(buf + n, sizeof(buf) - n, fmt, ap);
+		if (n < (int)sizeof(buf) && e != 0) {
+			n += snprintf(buf + n, sizeof(buf) - n, "%s%s",
+					fmt != NULL && fmt[0] != '\0' ?
+					": " : "", strerror(e));
+		}
+		if (n < (int)sizeof(buf) - 1)
+			strcpy(buf + n, "\n");
+		warn_hook(buf);
+		return;
+	}
+
 	vwarn(fmt, ap);
 	if (errno != 0) {
 		/* To avoid two colons being printed, like
@@ -10,7 +10,7 @@
 
 /**
  * @file err.h
- * @version 1.1.0
+ * @version 1.2.0
  * @brief Header file
  * @details #include this to use err in your project.
  */
@@ -23,6 +23,14 @@
  */
 extern char *argv0;
 
+/**
+ * @brief Global hook that warning messages are passed to.
+ * @details If this is set, warnings are not printed to stderr. Instead, each
+ * message is formatted whole, including the argv0 prefix and any newline
+ * printed after it, and passed to this function.
+ */
+extern void (*warn_hook)(const char *);
+
 /**
  * @brief Prints a formatted warning message to stderr.
  * @pre argv0 is set
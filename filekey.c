@@ -0,0 +1,150 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "err.h"
+#include "filekey.h"
+
+/* The greatest date that a file can be named as. See file_date(). */
+#define DATE_MAX 99999999L
+
+/* How many bits of a date are sorted on in each pass of filekey_sort(). Three
+ * passes cover DATE_MAX.
+ */
+#define DATE_RADIX_BITS 9
+
+static long file_date(const char *const);
+
+/*
+ * Return the date that name is, as the number YYYYMMDD, if it is eight digits
+ * long; otherwise -1. Names that are dates sort by strcmp(3) the same as the
+ * numbers do.
+ */
+static long
+file_date(const char *const name)
+{
+	long date;
+	int i;
+
+	date = 0;
+	for (i = 0; i < 8; i++) {
+		if (name[i] < '0' || name[i] > '9')
+			return -1;
+		date = date * 10 + name[i] - '0';
+	}
+
+	return name[8] == '\0' ? date : -1;
+}
+
+/*
+ * Compares two FileKeys such that the file named with the further date is
+ * "less than" the other. Return value shall be the negative of what strcmp()
+ * would return given the basenames of the files; names that are both dates
+ * are compared as numbers, which gives the same answer. Files with the same
+ * basename are compared by their whole paths, in ascending order, so that the
+ * order of files does not depend on the order that they were found in.
+ */
+int
+filekey_compare(const void *p1, const void *p2)
+{
+	const FileKey *const k1 = p1, *const k2 = p2;
+	int ret;
+
+	if (k1->date >= 0 && k2->date >= 0)
+		ret = (k1->date < k2->date) - (k1->date > k2->date);
+	else
+		ret = -strcmp(k1->base, k2->base);
+
+	return ret != 0 ? ret : strcmp(k1->path, k2->path);
+}
+
+/*
+ * Find what the file at path is sorted by, and store it in k. See
+ * filekey_compare().
+ */
+void
+filekey_init(FileKey *const k, char *const path)
+{
+	const char *const slash = strrchr(path, '/');
+
+	k->path = path;
+	k->base = slash != NULL ? slash + 1 : path;
+	k->date = file_date(k->base);
+}
+
+/*
+ * Sort the 'amt' FileKeys at keys so that the file named with the furthest
+ * date comes first, by filekey_compare(). When every file is named as a
+ * date, as the files at $NAVIPAGE_DIR are, the dates are sorted as numbers by
+ * a radix sort, and only files of the same date are compared.
+ */
+void
+filekey_sort(FileKey *keys, const int amt)
+{
+	FileKey *const v = keys;
+	FileKey *tmp, *swap;
+	long count[1 << DATE_RADIX_BITS], sum, n;
+	int i, j, shift;
+
+	for (i = 0; i < amt; i++) {
+		if (keys[i].date == -1) {
+			qsort(keys, amt, sizeof(*keys), filekey_compare);
+			return;
+		}
+	}
+
+	if ((tmp = malloc(sizeof(*tmp) * amt)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	/* Sort by DATE_MAX - date, least significant bits first, for the
+	 * furthest dates to come first.
+	 */
+	for (shift = 0; DATE_MAX >> shift != 0; shift += DATE_RADIX_BITS) {
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < amt; i++)
+			count[(DATE_MAX - keys[i].date) >> shift &
+				((1 << DATE_RADIX_BITS) - 1)]++;
+		for (sum = 0, n = 0; n < 1 << DATE_RADIX_BITS; n++) {
+			sum += count[n];
+			count[n] = sum - count[n];
+		}
+		for (i = 0; i < amt; i++)
+			tmp[count[(DATE_MAX - keys[i].date) >> shift &
+				((1 << DATE_RADIX_BITS) - 1)]++] = keys[i];
+		swap = keys;
+		keys = tmp;
+		tmp = swap;
+	}
+
+	/* The passes leave the keys in tmp, if there were an odd amount. */
+	if (keys != v) {
+		memcpy(v, keys, sizeof(*v) * amt);
+		tmp = keys;
+	}
+	free(tmp);
+
+	/* Files of the same date are sorted by path. */
+	for (i = 0; i < amt; i = j) {
+		for (j = i + 1; j < amt && v[j].date == v[i].date; j++)
+			;
+		if (j - i > 1)
+			qsort(v + i, j - i, sizeof(*v), filekey_compare);
+	}
+}
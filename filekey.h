@@ -0,0 +1,42 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef FILEKEY_H
+#define FILEKEY_H
+
+/*
+ * What a file is sorted by: its basename, and the number that it is if it is
+ * a date. See filekey_compare().
+ */
+typedef struct {
+	char *path;
+
+	/* The basename of path, which points into it. */
+	const char *base;
+
+	/* The basename as a number, if it is a date in YYYYMMDD form, or
+	 * else -1. See file_date().
+	 */
+	long date;
+} FileKey;
+
+int filekey_compare(const void *, const void *);
+void filekey_init(FileKey *const, char *const);
+void filekey_sort(FileKey *, const int);
+
+#endif /* FILEKEY_H */
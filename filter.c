@@ -0,0 +1,417 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "err.h"
+#include "filter.h"
+#include "lines.h"
+#include "loader.h"
+#include "navipage.h"
+#include "pattern.h"
+
+/* How many bytes of a buffer are searched at a time by match_lines(), between
+ * checks for whether the search has been cancelled.
+ */
+#define MATCH_CHUNK (1L << 20)
+
+/*
+ * Hands the filtering of buffers to the thread that does it, and what it finds
+ * back. See filter_thread().
+ */
+typedef struct {
+	/* Guards everything else here. */
+	pthread_mutex_t lock;
+
+	/* Signalled when there is a new filter to find the lines of. */
+	pthread_cond_t cond;
+
+	/* Incremented for every new filter, which cancels the last. */
+	unsigned long gen;
+
+	/* The buffer and pattern of the newest filter. The pattern is NULL if
+	 * the buffer is no longer to be filtered.
+	 */
+	Buffer *buffer;
+	Pattern *pattern;
+
+	/* The lines with the pattern, once they have all been found, and
+	 * whether they have yet to be taken by take_filter().
+	 */
+	int *v;
+	int amt;
+	int ready;
+
+	/* How much of the text of the buffer the lines were found in. It may
+	 * have been added to by the time they are taken; see grow_buffer().
+	 */
+	long length;
+
+	/* Set when the text of a buffer has been replaced, so that the lines of
+	 * the last filter are not narrowed down. See refilter_buffer().
+	 */
+	int replaced;
+
+	/* Whether the thread has been started. */
+	int started;
+} Filterer;
+
+static void *filter_thread(void *);
+
+Filterer filterer = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	0, NULL, NULL, NULL, 0, 0, 0, 0, 0
+};
+
+/*
+ * Bring the 'amt' lines at *v, which are the lines of b with the pattern p in
+ * the first 'from' bytes of its text, up to date with the text that has been
+ * added to b since. The line that went on past 'from' is looked at again.
+ * Returns the index in *v of the first line that was added.
+ */
+int
+add_lines(const Buffer *const b, const Pattern *const p, const long from,
+		int **const v, int *const amt)
+{
+	int *nv, namt, first, ret;
+
+	first = from == 0 ? 0 : lines_find(&b->st, from - 1) +
+		(b->text[from - 1] == '\n');
+	while (*amt > 0 && (*v)[*amt - 1] >= first)
+		(*amt)--;
+
+	ret = *amt;
+	if (first >= b->st.amt)
+		return ret;
+
+	match_lines(b, p, lines_start(&b->st, first), NULL, 0, &nv, &namt,
+			NULL);
+	if ((*v = realloc(*v, sizeof(**v) * (*amt + namt + 1))) == NULL)
+		err(EXIT_FAILURE, "realloc failed");
+	memcpy(*v + *amt, nv, sizeof(*nv) * namt);
+	*amt += namt;
+	free(nv);
+
+	return ret;
+}
+
+/*
+ * Filter b to the lines with the pattern source, or show all of its lines
+ * again if source is empty. The lines are found by filter_thread(), and shown
+ * once take_filter() takes them; a filter that is still being found when
+ * another is asked for is cancelled.
+ */
+void
+filter_buffer(Buffer *const b, const char *const source)
+{
+	Pattern *p;
+	pthread_t thread;
+	int line;
+
+	p = NULL;
+	if (source[0] != '\0' && (p = compile_pattern(source)) == NULL)
+		return;
+
+	pthread_mutex_lock(&filterer.lock);
+
+	if (filterer.buffer == b && filterer.pattern == p) {
+		/* That is what is being filtered for already. */
+		pthread_mutex_unlock(&filterer.lock);
+		if (p != NULL)
+			pattern_put(p);
+		return;
+	}
+
+	if (!filterer.started) {
+		if (pthread_create(&thread, NULL, filter_thread, NULL) != 0)
+			err(EXIT_FAILURE, "cannot pthread_create");
+		pthread_detach(thread);
+		filterer.started = 1;
+	}
+
+	filterer.gen++;
+	filterer.buffer = b;
+	if (filterer.pattern != NULL)
+		pattern_put(filterer.pattern);
+	filterer.pattern = p;
+	free(filterer.v);
+	filterer.v = NULL;
+	filterer.ready = 0;
+	pthread_cond_signal(&filterer.cond);
+
+	pthread_mutex_unlock(&filterer.lock);
+
+	if (p == NULL && b->filter.pattern != NULL) {
+		/* Show every line again, keeping the same one at the top. */
+		line = b->top < view_amt(b) ? view_line(b, b->top) : 0;
+		pattern_put(b->filter.pattern);
+		free(b->filter.v);
+		b->filter.pattern = NULL;
+		b->filter.v = NULL;
+		b->filter.amt = 0;
+		b->top = line < max_top(b) ? line : max_top(b);
+	}
+}
+
+/*
+ * The body of the thread that finds the lines of the filters asked for by
+ * filter_buffer(), one at a time, and hands them to take_filter(). A filter
+ * whose pattern contains that of the last one found for the same buffer is
+ * found among the lines of the last one, rather than among every line; so
+ * typing a pattern only searches the whole buffer once.
+ */
+static void *
+filter_thread(void *arg)
+{
+	Buffer *b, *lastb;
+	Pattern *p, *lastp;
+	unsigned long gen;
+	long length, lastlength;
+	int *v, amt, *lastv, lastamt;
+	int narrow, ret;
+
+	(void)arg;
+
+	gen = 0;
+	lastb = NULL;
+	lastp = NULL;
+	lastv = NULL;
+	lastamt = 0;
+	lastlength = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&filterer.lock);
+		while (filterer.gen == gen)
+			pthread_cond_wait(&filterer.cond, &filterer.lock);
+		gen = filterer.gen;
+		b = filterer.buffer;
+		p = filterer.pattern;
+		if (p != NULL)
+			pattern_keep(p);
+		if (filterer.replaced)
+			lastb = NULL;
+		filterer.replaced = 0;
+		pthread_mutex_unlock(&filterer.lock);
+
+		if (p == NULL)
+			continue;
+
+		/* The buffer is not added to while it is looked at. The main
+		 * thread is woken up after, in case it has more to add.
+		 */
+		pthread_rwlock_rdlock(&loader.text);
+		length = b->length;
+		narrow = lastp != NULL && lastb == b && lastlength == length &&
+			pattern_contains(p, lastp);
+		ret = match_lines(b, p, 0, narrow ? lastv : NULL, lastamt,
+				&v, &amt, &gen);
+		pthread_rwlock_unlock(&loader.text);
+
+		if (ret == -1) {
+			pattern_put(p);
+			wake_up();
+			continue;
+		}
+
+		pthread_mutex_lock(&filterer.lock);
+		if (filterer.gen == gen) {
+			if ((filterer.v = malloc(sizeof(*v) * (amt + 1))) ==
+					NULL)
+				err(EXIT_FAILURE, "malloc failed");
+			memcpy(filterer.v, v, sizeof(*v) * amt);
+			filterer.amt = amt;
+			filterer.length = length;
+			filterer.ready = 1;
+		}
+		pthread_mutex_unlock(&filterer.lock);
+		wake_up();
+
+		free(lastv);
+		if (lastp != NULL)
+			pattern_put(lastp);
+		lastb = b;
+		lastp = p;
+		lastv = v;
+		lastamt = amt;
+		lastlength = length;
+	}
+
+	return NULL;
+}
+
+/*
+ * Find the lines of b that have the pattern p, and store them in order in a
+ * new array at *v, and how many there are at *amt. The text is looked at from
+ * the start of a line at 'from' on; or if among is not NULL, only the 'amt'
+ * lines at among are looked at. If gen is not NULL, the search
+ * stops once filterer.gen is no longer *gen, in which case -1 is returned and
+ * nothing is stored; otherwise 0 is returned.
+ */
+int
+match_lines(const Buffer *const b, const Pattern *const p, const long from,
+		const int *const among, const int amongamt, int **const v,
+		int *const amt, const unsigned long *const gen)
+{
+	long pos, off, end, chunkend;
+	int i, line, size, stale;
+
+	*v = NULL;
+	*amt = size = 0;
+	pos = from;
+	i = 0;
+
+	for (;;) {
+		if (gen != NULL) {
+			pthread_mutex_lock(&filterer.lock);
+			stale = filterer.gen != *gen;
+			pthread_mutex_unlock(&filterer.lock);
+			if (stale) {
+				free(*v);
+				*v = NULL;
+				return -1;
+			}
+		}
+
+		if (among != NULL) {
+			if (i >= amongamt)
+				break;
+			/* Look at a chunk of the lines at among, one at a
+			 * time.
+			 */
+			for (pos = 0; i < amongamt && pos < MATCH_CHUNK; i++) {
+				line = among[i];
+				off = lines_start(&b->st, line);
+				chunkend = lines_end(&b->st, line, b->length);
+				pos += chunkend - off;
+				if (pattern_next(p, b->text, off, chunkend,
+							&end) == -1)
+					continue;
+				if (*amt == size) {
+					size = size == 0 ? 64 : size * 2;
+					*v = realloc(*v, sizeof(**v) * size);
+					if (*v == NULL)
+						err(EXIT_FAILURE,
+							"realloc failed");
+				}
+				(*v)[(*amt)++] = line;
+			}
+			continue;
+		}
+
+		if (pos >= b->length)
+			break;
+
+		/* Look at the next chunk of text, up to the end of a line. */
+		chunkend = pos + MATCH_CHUNK >= b->length ? b->length :
+			lines_end(&b->st, lines_find(&b->st, pos + MATCH_CHUNK),
+					b->length);
+
+		/* Only the first match on each line matters. An empty match at
+		 * the end of the chunk is on the first line of the next one.
+		 */
+		for (off = pos; (off = pattern_next(p, b->text, off, chunkend,
+						&end)) != -1 &&
+				(off < chunkend || chunkend == b->length);
+				off = lines_end(&b->st, line, b->length)) {
+			line = lines_find(&b->st, off);
+			if (*amt == size) {
+				size = size == 0 ? 64 : size * 2;
+				if ((*v = realloc(*v, sizeof(**v) * size)) ==
+						NULL)
+					err(EXIT_FAILURE, "realloc failed");
+			}
+			(*v)[(*amt)++] = line;
+		}
+		pos = chunkend;
+	}
+
+	return 0;
+}
+
+/*
+ * Make sure that no lines found by filter_thread() in the text that b had
+ * before it was replaced are shown. A filter of b that has yet to be taken by
+ * take_filter() is found again from the start. Lines already taken are kept up
+ * to date by grow_buffer().
+ */
+void
+refilter_buffer(Buffer *const b)
+{
+	pthread_mutex_lock(&filterer.lock);
+	filterer.replaced = 1;
+	if (filterer.buffer == b && filterer.pattern != NULL &&
+			(filterer.ready ||
+			 b->filter.pattern != filterer.pattern)) {
+		filterer.gen++;
+		free(filterer.v);
+		filterer.v = NULL;
+		filterer.ready = 0;
+		pthread_cond_signal(&filterer.cond);
+	}
+	pthread_mutex_unlock(&filterer.lock);
+}
+
+/*
+ * Show the lines of the newest filter, if filter_thread() has found them
+ * since this was last called. Returns nonzero if it had.
+ */
+int
+take_filter(void)
+{
+	Buffer *b;
+	long length;
+	int line;
+
+	pthread_mutex_lock(&filterer.lock);
+	if (!filterer.ready) {
+		pthread_mutex_unlock(&filterer.lock);
+		return 0;
+	}
+
+	b = filterer.buffer;
+	length = filterer.length;
+
+	/* Keep the same line at the top, or the one after it if it is
+	 * filtered out.
+	 */
+	line = b->top < view_amt(b) ? view_line(b, b->top) : 0;
+
+	if (b->filter.pattern != NULL)
+		pattern_put(b->filter.pattern);
+	free(b->filter.v);
+	b->filter.pattern = pattern_keep(filterer.pattern);
+	b->filter.v = filterer.v;
+	b->filter.amt = filterer.amt;
+	filterer.v = NULL;
+	filterer.ready = 0;
+
+	pthread_mutex_unlock(&filterer.lock);
+
+	/* The buffer may have been added to since the lines were found. */
+	if (length < b->length)
+		add_lines(b, b->filter.pattern, length, &b->filter.v,
+				&b->filter.amt);
+
+	b->top = view_find(b, line) < max_top(b) ?
+		view_find(b, line) : max_top(b);
+
+	return 1;
+}
@@ -0,0 +1,34 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "navipage.h"
+#include "pattern.h"
+
+int add_lines(const Buffer *const, const Pattern *const, const long,
+		int **const, int *const);
+void filter_buffer(Buffer *const, const char *const);
+int match_lines(const Buffer *const, const Pattern *const, const long,
+		const int *const, const int, int **const, int *const,
+		const unsigned long *const);
+void refilter_buffer(Buffer *const);
+int take_filter(void);
+
+#endif /* FILTER_H */
@@ -0,0 +1,332 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "filter.h"
+#include "follow.h"
+#include "lines.h"
+#include "loader.h"
+#include "navipage.h"
+#include "pattern.h"
+#include "stream.h"
+
+/* What is watched for in a file that is followed, and in its directory. A log
+ * that is rotated is renamed or deleted, and a new file made in its place. See
+ * follow_buffer().
+ */
+#define FOLLOW_EVENTS (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+#define FOLLOW_DIR_EVENTS (IN_CREATE | IN_MOVED_TO)
+
+static int remap_buffer(Buffer *const, const int, const off_t);
+
+Follow follow = { NULL, -1, -1, -1, -1, 0, 0 };
+
+/*
+ * Start following b, scrolling to the bottom of it: whenever its file is
+ * written to, what is new is added to the end of b. If b is being followed
+ * already, it stops being followed instead. Only one buffer is followed at a
+ * time. If the file cannot be watched, message is set to say why.
+ */
+void
+follow_buffer(Buffer *const b)
+{
+	static char error[128];
+	struct stat statbuf;
+	const Buffer *last;
+	const char *path, *why;
+	char *dir;
+	int fd, watch;
+
+	last = follow.buffer;
+	if (last != NULL) {
+		if (follow.fd != -1) {
+			inotify_rm_watch(follow.notify, follow.watch);
+			close(follow.fd);
+		}
+		if (follow.dirwatch != -1)
+			inotify_rm_watch(follow.notify, follow.dirwatch);
+		follow.buffer = NULL;
+		follow.dirwatch = -1;
+		follow.changed = follow.reopen = 0;
+		if (last == b)
+			return;
+	}
+
+	/* What is piped to standard input is added to its buffer anyway, so
+	 * it only has to be kept at the bottom. Standard input that was mapped
+	 * from a file is watched through /dev/stdin.
+	 */
+	fd = watch = -1;
+	if (b != stream.buffer || stream.file) {
+		path = b == stream.buffer ? "/dev/stdin" : b->key.path;
+
+		/* Only regular files are added to; opening a FIFO would wait
+		 * for something to write to it.
+		 */
+		why = NULL;
+		if (stat(path, &statbuf) == -1)
+			why = strerror(errno);
+		else if (!S_ISREG(statbuf.st_mode))
+			why = "not a regular file";
+		else if (follow.notify == -1 && (follow.notify =
+					inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+				== -1)
+			why = strerror(errno);
+		else if ((fd = b == stream.buffer ? dup(STDIN_FILENO) :
+					open(path, O_RDONLY)) == -1)
+			why = strerror(errno);
+		else if ((watch = inotify_add_watch(follow.notify, path,
+						FOLLOW_EVENTS)) == -1)
+			why = strerror(errno);
+
+		if (why != NULL) {
+			snprintf(error, sizeof(error), "cannot follow %s: %s",
+					b->key.path, why);
+			message = error;
+			if (fd != -1)
+				close(fd);
+			return;
+		}
+	}
+
+	/* A new file made at the path of the file is followed instead of it.
+	 * Standard input has no path to be made at.
+	 */
+	if (fd != -1 && b != stream.buffer) {
+		if ((dir = malloc(b->key.base - b->key.path + 2)) == NULL)
+			err(EXIT_FAILURE, "malloc failed");
+		if (b->key.base == b->key.path)
+			strcpy(dir, ".");
+		else
+			sprintf(dir, "%.*s", (int)(b->key.base - b->key.path),
+					b->key.path);
+		follow.dirwatch = inotify_add_watch(follow.notify, dir,
+				FOLLOW_DIR_EVENTS);
+		free(dir);
+	}
+
+	follow.buffer = b;
+	follow.fd = fd;
+	follow.watch = watch;
+
+	/* The file may have been written to since it was read. The caller
+	 * takes what is new with take_follow().
+	 */
+	follow.changed = 1;
+
+	b->top = max_top(b);
+}
+
+/*
+ * Read the events that inotify(7) has for the file being followed, and set
+ * follow.changed, and follow.reopen if the file may have been replaced. This
+ * is called by read_input() once follow.notify can be read from.
+ */
+void
+read_follow(void)
+{
+	const struct inotify_event *e;
+	const char *base;
+	long events[512];
+	ssize_t n;
+	size_t off;
+
+	/* Only one file, and its directory, are ever watched. Events other
+	 * than writes to the file may mean it has been replaced.
+	 */
+	base = follow.buffer != NULL ? follow.buffer->key.base : "";
+	while ((n = read(follow.notify, events, sizeof(events))) > 0) {
+		for (off = 0; off < (size_t)n; off += sizeof(*e) + e->len) {
+			e = (const struct inotify_event *)
+				((char *)events + off);
+			if (e->wd == follow.dirwatch ?
+					e->len > 0 &&
+					strcmp(e->name, base) == 0 :
+					(e->mask & FOLLOW_EVENTS &
+					 ~IN_MODIFY) != 0)
+				follow.reopen = 1;
+		}
+	}
+	follow.changed = 1;
+}
+
+/*
+ * Map the first 'length' bytes of the file open at fd into b, which is mapped,
+ * and unmap what was mapped before. This is how the mapped text of a followed
+ * file is added to, so that it is never copied. Readers of the text must be
+ * kept out with loader.text. Returns 0 on success, or -1 on error, in which
+ * case b is left alone.
+ */
+static int
+remap_buffer(Buffer *const b, const int fd, const off_t length)
+{
+	char *const text = b->text;
+	const long old = b->length;
+
+	if (map_buffer(b, fd, length) == -1)
+		return -1;
+	if (text != NULL)
+		munmap(text, old);
+
+	return 0;
+}
+
+/*
+ * Add what has been written to the end of the file of the buffer being
+ * followed since it was last read, if inotify(7) has said that it has been
+ * written to. Only what is new is read, with pread(2), unless the text is
+ * mapped, in which case the file is mapped again. Nothing is added while
+ * another thread reads a buffer, as that thread wakes the main thread up once
+ * it is done; but if the file was truncated, this waits for it. Returns
+ * nonzero if anything changed.
+ */
+int
+take_follow(void)
+{
+	static char error[128];
+	Buffer *const b = follow.buffer;
+	struct stat statbuf, now;
+	const char *why;
+	long old;
+	ssize_t n;
+	int fd;
+
+	if (b == NULL || !follow.changed || follow.fd == -1)
+		return 0;
+
+	/* Once there is a new file at the path of the one being followed, it
+	 * is followed instead, from its start. Until then, the old one still
+	 * is, as it may still be written to.
+	 */
+	why = NULL;
+	if (follow.reopen && stat(b->key.path, &now) == 0 &&
+			S_ISREG(now.st_mode) &&
+			fstat(follow.fd, &statbuf) == 0 &&
+			(now.st_dev != statbuf.st_dev ||
+			 now.st_ino != statbuf.st_ino) &&
+			(fd = open(b->key.path, O_RDONLY)) != -1) {
+		inotify_rm_watch(follow.notify, follow.watch);
+		close(follow.fd);
+		follow.fd = fd;
+		follow.watch = inotify_add_watch(follow.notify, b->key.path,
+				FOLLOW_EVENTS);
+		why = "was replaced";
+	}
+	follow.reopen = 0;
+
+	if (fstat(follow.fd, &statbuf) == -1) {
+		snprintf(error, sizeof(error), "cannot follow %s: %s",
+				b->key.path, strerror(errno));
+		message = error;
+		follow_buffer(b);
+		return 1;
+	}
+
+	/* What was read before is not there anymore if the file was
+	 * replaced or truncated, so it is read again from the start, as
+	 * tail(1) does. Other threads that are reading the text are waited for
+	 * then, so that none of them sees the buffer at its old length;
+	 * otherwise, what is new is added the next time that none is.
+	 */
+	if (why == NULL && statbuf.st_size < b->length)
+		why = "was truncated";
+	if (why != NULL)
+		pthread_rwlock_wrlock(&loader.text);
+	else if (pthread_rwlock_trywrlock(&loader.text) != 0)
+		return 0;
+
+	follow.changed = 0;
+
+	if (why != NULL) {
+		/* The lines with the pattern of the last search are found
+		 * again when they are needed.
+		 */
+		if (b->mapped && b->text != NULL)
+			munmap(b->text, b->length);
+		if (b->mapped)
+			b->text = NULL;
+		b->length = 0;
+		b->st.amt = 0;
+		b->top = 0;
+		b->filter.amt = 0;
+		b->watched.amt = b->watched.hits = 0;
+		if (b->matches.pattern != NULL)
+			pattern_put(b->matches.pattern);
+		free(b->matches.v);
+		free(b->matches.bits);
+		memset(&b->matches, 0, sizeof(b->matches));
+		forget_highlights(b);
+		refilter_buffer(b);
+
+		snprintf(error, sizeof(error), "%s %s", b->key.path, why);
+		message = error;
+	}
+	old = b->length;
+
+	if (statbuf.st_size > old && b->mapped) {
+		if (remap_buffer(b, follow.fd, statbuf.st_size) == -1) {
+			snprintf(error, sizeof(error), "cannot follow %s: %s",
+					b->key.path, strerror(errno));
+			message = error;
+			pthread_rwlock_unlock(&loader.text);
+			follow_buffer(b);
+			return 1;
+		}
+	} else if (statbuf.st_size > old) {
+		/* Double the space whenever it runs out, like read_buffer()
+		 * does.
+		 */
+		if (statbuf.st_size > b->size) {
+			if (b->size == 0)
+				b->size = TEXT_SIZE_INIT;
+			while (statbuf.st_size > b->size)
+				b->size *= 2;
+			b->text = realloc(b->text, sizeof(*b->text) * b->size);
+			if (b->text == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		while (b->length < statbuf.st_size) {
+			n = pread(follow.fd, b->text + b->length,
+					statbuf.st_size - b->length,
+					b->length);
+			if (n == -1 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				break;
+			b->length += n;
+		}
+	}
+
+	grow_buffer(b, old);
+
+	pthread_rwlock_unlock(&loader.text);
+
+	return 1;
+}
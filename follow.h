@@ -0,0 +1,61 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef FOLLOW_H
+#define FOLLOW_H
+
+#include "navipage.h"
+
+/*
+ * The buffer being followed with 'F', whose file is watched with inotify(7) for
+ * what is written to the end of it. See take_follow().
+ */
+typedef struct {
+	/* The buffer, or NULL if none is being followed. */
+	Buffer *buffer;
+
+	/* The file of the buffer, open for reading, and its watch; or -1 for
+	 * a pipe to standard input, which is added to anyway. If the text of
+	 * the buffer is mapped, it is mapped again to be added to; see
+	 * remap_buffer().
+	 */
+	int fd;
+	int watch;
+
+	/* The watch of the directory of the file, or -1. */
+	int dirwatch;
+
+	/* The inotify instance that files are watched with, or -1 if nothing
+	 * has been followed yet.
+	 */
+	int notify;
+
+	/* Whether the file has been written to since it was last read, and
+	 * whether it may have been replaced by another at its path.
+	 */
+	int changed;
+	int reopen;
+} Follow;
+
+extern Follow follow;
+
+void follow_buffer(Buffer *const);
+void read_follow(void);
+int take_follow(void);
+
+#endif /* FOLLOW_H */
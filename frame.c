@@ -0,0 +1,290 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "frame.h"
+
+/* How much space a frame has before it is first grown. */
+#define FRAME_SIZE_INIT 4096
+
+/* Escape sequences that begin and end a synchronized update. */
+#define SYNC_BEGIN "\033[?2026h"
+#define SYNC_END   "\033[?2026l"
+
+/*
+ * Make sure that f has room for 'n' more characters. Upon irreconciliable
+ * errors, such as running out of memory, the program shall be exited with
+ * code EXIT_FAILURE.
+ */
+static void
+reserve(Frame *const f, const size_t n)
+{
+	if (f->len + n <= f->size)
+		return;
+
+	/* Double the space, so that the frame soon stops growing. */
+	if (f->size == 0)
+		f->size = FRAME_SIZE_INIT;
+	while (f->size < f->len + n)
+		f->size *= 2;
+
+	if ((f->v = realloc(f->v, f->size)) == NULL)
+		err(EXIT_FAILURE, "realloc failed");
+}
+
+/*
+ * Start a new frame in f, discarding anything left from the last one.
+ */
+void
+frame_begin(Frame *const f)
+{
+	f->len = 0;
+	if (f->sync)
+		frame_puts(f, SYNC_BEGIN);
+}
+
+/*
+ * Write the frame in f to fd. Anything still buffered in stdout is written
+ * first, so that it is not drawn over the frame later. Returns 0 on success,
+ * -1 on error.
+ */
+int
+frame_flush(Frame *const f, const int fd)
+{
+	const char *p;
+	ssize_t n;
+
+	if (f->sync)
+		frame_puts(f, SYNC_END);
+
+	fflush(stdout);
+
+	for (p = f->v; p < f->v + f->len; p += n) {
+		if ((n = write(fd, p, f->v + f->len - p)) == -1) {
+			if (errno == EINTR) {
+				n = 0;
+				continue;
+			}
+			return -1;
+		}
+	}
+
+	f->len = 0;
+
+	return 0;
+}
+
+/*
+ * Move the cursor to column x of row y, counting from 1.
+ */
+void
+frame_goto(Frame *const f, const int x, const int y)
+{
+	frame_printf(f, "\033[%d;%dH", y, x);
+}
+
+/*
+ * Forget what every row of the terminal shows, so that every row is drawn in
+ * full in the next frame. This must be called after anything is drawn to the
+ * terminal other than through f.
+ */
+void
+frame_invalidate(Frame *const f)
+{
+	int i;
+
+	for (i = 0; i < f->nrows; i++)
+		f->rows[i].valid = 0;
+}
+
+/*
+ * Append printf(3)-like-formatted output to f.
+ */
+void
+frame_printf(Frame *const f, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+
+	if (n < 0)
+		return;
+
+	/* vsnprintf() writes a null character that is not kept. */
+	reserve(f, n + 1);
+
+	va_start(ap, fmt);
+	vsnprintf(f->v + f->len, n + 1, fmt, ap);
+	va_end(ap);
+
+	f->len += n;
+}
+
+/*
+ * Append the 'n' characters at s to f.
+ */
+void
+frame_put(Frame *const f, const char *const s, const size_t n)
+{
+	if (n == 0)
+		return;
+
+	reserve(f, n);
+	memcpy(f->v + f->len, s, n);
+	f->len += n;
+}
+
+/*
+ * Append the string s to f.
+ */
+void
+frame_puts(Frame *const f, const char *const s)
+{
+	frame_put(f, s, strlen(s));
+}
+
+/*
+ * Set the amount of rows that the terminal has to 'n'. What every row shows
+ * is forgotten. Upon irreconciliable errors, such as running out of memory,
+ * the program shall be exited with code EXIT_FAILURE.
+ */
+void
+frame_resize(Frame *const f, const int n)
+{
+	int i;
+
+	for (i = 0; i < f->nrows; i++)
+		free(f->rows[i].v);
+	free(f->rows);
+
+	f->nrows = n > 0 ? n : 0;
+	if ((f->rows = calloc(f->nrows + 1, sizeof(*f->rows))) == NULL)
+		err(EXIT_FAILURE, "calloc failed");
+}
+
+/*
+ * Start drawing row y, counting from 1. Everything added to f until
+ * frame_row_end() is what the row should show, and must not move the cursor
+ * off of the row.
+ */
+void
+frame_row_begin(Frame *const f, const int y)
+{
+	f->rowstart = f->len;
+	frame_goto(f, 1, y);
+	f->rowtext = f->len;
+}
+
+/*
+ * Finish drawing row y. If the row already shows what was drawn, it is taken
+ * back out of the frame; otherwise the rest of the row is erased, and the row
+ * is remembered as showing what was drawn.
+ */
+void
+frame_row_end(Frame *const f, const int y)
+{
+	Row *r;
+	const size_t len = f->len - f->rowtext;
+
+	if (y < 1 || y > f->nrows) {
+		frame_puts(f, "\033[K");
+		return;
+	}
+
+	r = &f->rows[y - 1];
+	if (r->valid && r->len == len &&
+			memcmp(r->v, f->v + f->rowtext, len) == 0) {
+		f->len = f->rowstart;
+		return;
+	}
+
+	if (r->size < len) {
+		r->size = len;
+		if ((r->v = realloc(r->v, r->size)) == NULL)
+			err(EXIT_FAILURE, "realloc failed");
+	}
+	if (len > 0)
+		memcpy(r->v, f->v + f->rowtext, len);
+	r->len = len;
+	r->valid = 1;
+
+	frame_puts(f, "\033[K");
+}
+
+/*
+ * Have the terminal move the contents of rows 'first' through 'last' up by
+ * 'n' rows, or down if n is negative, and update what those rows are known
+ * to show to match. The rows that are moved into are blank afterwards.
+ *
+ * This uses a VT100 scrolling region (DECSTBM), so that rows outside of it
+ * stay in place. Within it, an index (IND) at the bottom row moves every row
+ * up, and a reverse index (RI) at the top row moves every row down.
+ *
+ * Nothing is done if any of the rows is not known, since then moving the rows
+ * would not save drawing them. Returns 1 if the rows were moved, 0 if not.
+ */
+int
+frame_scroll(Frame *const f, const int first, const int last, const int n)
+{
+	Row tmp;
+	int i, j, m;
+
+	m = n > 0 ? n : -n;
+	if (n == 0 || first < 1 || last > f->nrows || m > last - first)
+		return 0;
+	for (i = first; i <= last; i++)
+		if (!f->rows[i - 1].valid)
+			return 0;
+
+	frame_printf(f, "\033[%d;%dr", first, last);
+	frame_goto(f, 1, n > 0 ? last : first);
+	for (i = 0; i < m; i++)
+		frame_puts(f, n > 0 ? "\033D" : "\033M");
+	frame_puts(f, "\033[r");
+
+	/* Rotate the rows by one, m times, keeping the allocations of the rows
+	 * that are moved off of the region for the blank rows.
+	 */
+	for (j = 0; j < m; j++) {
+		if (n > 0) {
+			tmp = f->rows[first - 1];
+			for (i = first; i < last; i++)
+				f->rows[i - 1] = f->rows[i];
+			f->rows[last - 1] = tmp;
+			f->rows[last - 1].len = 0;
+		} else {
+			tmp = f->rows[last - 1];
+			for (i = last; i > first; i--)
+				f->rows[i - 1] = f->rows[i - 2];
+			f->rows[first - 1] = tmp;
+			f->rows[first - 1].len = 0;
+		}
+	}
+
+	return 1;
+}
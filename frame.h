@@ -0,0 +1,88 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+
+/*
+ * What one row of the terminal is known to show.
+ */
+typedef struct {
+	/* What was last written to the row, not counting the escape sequences
+	 * used to move to it or to erase the rest of it.
+	 */
+	char *v;
+	size_t len;
+
+	/* The amount of space allocated for v. */
+	size_t size;
+
+	/* Whether or not v is known to be what the row shows. */
+	int valid;
+} Row;
+
+/*
+ * A frame of output to the terminal. Everything that is drawn for a frame is
+ * put together in memory first, and then written with a single write(2), so
+ * that it costs a constant amount of system calls, and so that the terminal
+ * never shows a frame that is only partly drawn.
+ */
+typedef struct {
+	/* The output of the frame so far. This is reused between frames. */
+	char *v;
+
+	/* The length of the output so far. */
+	size_t len;
+
+	/* The amount of space allocated for v. */
+	size_t size;
+
+	/* Whether or not to ask the terminal to show the frame all at once,
+	 * with the synchronized update escape sequences. Terminals that do not
+	 * support them ignore them.
+	 */
+	int sync;
+
+	/* What every row of the terminal shows, so that rows which are drawn
+	 * the same as they already are can be left out of the frame.
+	 */
+	Row *rows;
+	int nrows;
+
+	/* Where the row being drawn starts in v, and where its contents
+	 * start, after the escape sequence that moves to it. See
+	 * frame_row_begin().
+	 */
+	size_t rowstart, rowtext;
+} Frame;
+
+void frame_begin(Frame *const);
+int frame_flush(Frame *const, const int);
+void frame_goto(Frame *const, const int, const int);
+void frame_invalidate(Frame *const);
+void frame_printf(Frame *const, const char *, ...);
+void frame_put(Frame *const, const char *const, const size_t);
+void frame_puts(Frame *const, const char *const);
+void frame_resize(Frame *const, const int);
+void frame_row_begin(Frame *const, const int);
+void frame_row_end(Frame *const, const int);
+int frame_scroll(Frame *const, const int, const int, const int);
+
+#endif /* FRAME_H */
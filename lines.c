@@ -0,0 +1,662 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "lines.h"
+#include "pool.h"
+
+/* How many lines li->v has room for before it is first grown. */
+#define LINES_SIZE_INIT 64
+
+/* Texts at least this many characters long are split into chunks which are
+ * indexed on every core at once. See config.mk.
+ */
+#ifndef LINES_PARALLEL_MIN
+#define LINES_PARALLEL_MIN (64L << 20)
+#endif
+
+/* The most chunks a text is split into. */
+#define CHUNKS_MAX 64
+
+/* Only texts at least this many characters long have their index cached, as
+ * shorter ones are indexed faster than the cache can be read. The cache is
+ * kept under LINES_CACHE_MAX bytes. See config.mk.
+ */
+#ifndef LINES_CACHE_MIN
+#define LINES_CACHE_MIN (1L << 20)
+#endif
+#ifndef LINES_CACHE_MAX
+#define LINES_CACHE_MAX (256L << 20)
+#endif
+
+/* Identifies a file as a cached index of this layout. Bump the version
+ * whenever the layout changes, so that old caches are rebuilt.
+ */
+#define CACHE_MAGIC "NPLI"
+#define CACHE_VERSION 1
+
+/* How many cached indexes evict() has room for before it is first grown. */
+#define CACHED_SIZE_INIT 64
+
+/*
+ * One chunk of a text that is being indexed in parallel.
+ */
+typedef struct {
+	/* The index being filled, and the text it is of. */
+	LineIndex *li;
+	const char *text;
+	long length;
+
+	/* The part of the text that this chunk covers. */
+	long start, end;
+
+	/* How many lines start in this chunk. In the second pass, this is
+	 * instead the index in li at which the chunk's lines are stored.
+	 */
+	int amt;
+} Chunk;
+
+/*
+ * The start of a cached index. It is followed by the offsets of the lines,
+ * which are as wide as those of the index. The rest identifies the file
+ * that the index is of, as it was when it was indexed.
+ */
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint64_t dev, ino, size;
+	int64_t sec, nsec;
+	int32_t wide;
+	int32_t amt;
+} CacheHeader;
+
+/*
+ * A cached index, as seen by evict().
+ */
+typedef struct {
+	char *name;
+	off_t size;
+	struct timespec used;
+} Cached;
+
+/*
+ * Copy li, which was mapped from the cache by lines_load(), onto the heap, so
+ * that it can be added to.
+ */
+static void
+unmap(LineIndex *const li)
+{
+	const size_t width = li->wide ?
+		sizeof(*li->v.wide) : sizeof(*li->v.narrow);
+	void *v;
+
+	if ((v = malloc(width * li->amt)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	memcpy(v, li->wide ? (void *)li->v.wide : (void *)li->v.narrow,
+			width * li->amt);
+	munmap(li->map, li->maplen);
+
+	if (li->wide)
+		li->v.wide = v;
+	else
+		li->v.narrow = v;
+	li->size = li->amt;
+	li->map = NULL;
+	li->maplen = 0;
+}
+
+/*
+ * Append the offset of the start of a line to li.
+ */
+static void
+append(LineIndex *const li, const long offset)
+{
+	void *v;
+
+	if (li->map != NULL)
+		unmap(li);
+
+	/* Double the space whenever it runs out, so that the amount of
+	 * reallocations only grows logarithmically with the amount of lines.
+	 */
+	if (li->amt == li->size) {
+		li->size = li->size == 0 ? LINES_SIZE_INIT : li->size * 2;
+		if (li->wide)
+			v = realloc(li->v.wide, sizeof(*li->v.wide) * li->size);
+		else
+			v = realloc(li->v.narrow,
+					sizeof(*li->v.narrow) * li->size);
+		if (v == NULL)
+			err(EXIT_FAILURE, "realloc failed");
+		if (li->wide)
+			li->v.wide = v;
+		else
+			li->v.narrow = v;
+	}
+
+	if (li->wide)
+		li->v.wide[li->amt++] = offset;
+	else
+		li->v.narrow[li->amt++] = offset;
+}
+
+/*
+ * Switch li over to wide offsets, once the text that it is of has grown longer
+ * than UINT32_MAX characters.
+ */
+static void
+widen(LineIndex *const li)
+{
+	long *v;
+	int i;
+
+	if (li->map != NULL)
+		unmap(li);
+
+	if ((v = malloc(sizeof(*v) * (li->size > 0 ? li->size : 1))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	for (i = 0; i < li->amt; i++)
+		v[i] = li->v.narrow[i];
+	free(li->v.narrow);
+
+	li->v.wide = v;
+	li->wide = 1;
+}
+
+/*
+ * The first pass of parallel indexing, run on its own thread for each chunk
+ * at arg. Counts the lines that start in the chunk, which are those after a
+ * newline in it that is not the last character of the text.
+ */
+static void *
+count_chunk(void *arg)
+{
+	Chunk *const c = arg;
+	const char *p, *const end = c->text + c->end;
+
+	c->amt = 0;
+	for (p = c->text + c->start;
+			(p = memchr(p, '\n', end - p)) != NULL; p++) {
+		if (p + 1 < c->text + c->length)
+			c->amt++;
+	}
+
+	return NULL;
+}
+
+/*
+ * The second pass of parallel indexing, run on its own thread for each chunk
+ * at arg. Stores the offsets of the lines that start in the chunk, from
+ * index c->amt of c->li onwards.
+ */
+static void *
+fill_chunk(void *arg)
+{
+	Chunk *const c = arg;
+	const char *p, *const end = c->text + c->end;
+	int i = c->amt;
+
+	for (p = c->text + c->start;
+			(p = memchr(p, '\n', end - p)) != NULL; p++) {
+		if (p + 1 >= c->text + c->length)
+			break;
+		if (c->li->wide)
+			c->li->v.wide[i++] = p + 1 - c->text;
+		else
+			c->li->v.narrow[i++] = p + 1 - c->text;
+	}
+
+	return NULL;
+}
+
+/*
+ * Call fn once for every one of the 'n' chunks at c, each on its own thread,
+ * and wait for them all to return. The first chunk is handled by the calling
+ * thread; should a thread fail to start, its chunk is handled there too.
+ */
+static void
+run_chunks(void *(*fn)(void *), Chunk *const c, const int n)
+{
+	pthread_t threads[CHUNKS_MAX];
+	int started[CHUNKS_MAX];
+	int i;
+
+	for (i = 1; i < n; i++)
+		started[i] = pthread_create(&threads[i], NULL, fn, &c[i]) == 0;
+
+	fn(&c[0]);
+
+	for (i = 1; i < n; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			fn(&c[i]);
+	}
+}
+
+/*
+ * Index a long text by splitting it into 'n' chunks, counting the lines in
+ * each chunk in parallel, and then, once the position of each chunk's lines
+ * in li is known from the counts of the chunks before it, storing the
+ * offsets of the lines in parallel. Unlike lines_index(), li is allocated at
+ * exactly the size needed.
+ */
+static void
+index_parallel(LineIndex *const li, const char *const text,
+		const long length, const int n)
+{
+	Chunk c[CHUNKS_MAX];
+	void *v;
+	int i, amt;
+
+	for (i = 0; i < n; i++) {
+		c[i].li = li;
+		c[i].text = text;
+		c[i].length = length;
+		c[i].start = length / n * i;
+		c[i].end = i == n - 1 ? length : length / n * (i + 1);
+	}
+
+	run_chunks(count_chunk, c, n);
+
+	/* The first line, at offset 0, does not follow a newline, so the
+	 * first chunk's lines are stored after it.
+	 */
+	for (amt = 1, i = 0; i < n; i++) {
+		const int chunkamt = c[i].amt;
+
+		c[i].amt = amt;
+		amt += chunkamt;
+	}
+
+	li->amt = li->size = amt;
+	if (li->wide)
+		v = li->v.wide = malloc(sizeof(*li->v.wide) * li->size);
+	else
+		v = li->v.narrow = malloc(sizeof(*li->v.narrow) * li->size);
+	if (v == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	if (li->wide)
+		li->v.wide[0] = 0;
+	else
+		li->v.narrow[0] = 0;
+
+	run_chunks(fill_chunk, c, n);
+}
+
+/*
+ * Return the path of the cached index, in the directory dir, of the file
+ * described by st. The path must be freed by the caller.
+ */
+static char *
+cache_name(const char *const dir, const struct stat *const st)
+{
+	char *path;
+
+	/* Two hexadecimal numbers of at most 64 bits, a slash, and a dash. */
+	if ((path = malloc(strlen(dir) + 16 * 2 + 3)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	sprintf(path, "%s/%llx-%llx", dir, (unsigned long long)st->st_dev,
+			(unsigned long long)st->st_ino);
+
+	return path;
+}
+
+/*
+ * qsort(3) comparator of Cached indexes, from least to most recently used.
+ */
+static int
+compare_cached(const void *p1, const void *p2)
+{
+	const struct timespec *t1 = &((const Cached *)p1)->used,
+		*t2 = &((const Cached *)p2)->used;
+
+	if (t1->tv_sec != t2->tv_sec)
+		return (t1->tv_sec > t2->tv_sec) - (t1->tv_sec < t2->tv_sec);
+	return (t1->tv_nsec > t2->tv_nsec) - (t1->tv_nsec < t2->tv_nsec);
+}
+
+/*
+ * Remove the least recently used indexes from the cache in the directory dir
+ * until it is no more than LINES_CACHE_MAX bytes. An index is used when it is
+ * written or loaded, which is when its modification time is set.
+ */
+static void
+evict(const char *const dir)
+{
+	struct dirent *d;
+	struct stat statbuf;
+	Cached *v;
+	DIR *dirp;
+	long long total;
+	int amt, size, i;
+
+	if ((dirp = opendir(dir)) == NULL)
+		return;
+
+	v = NULL;
+	amt = size = 0;
+	total = 0;
+	while ((d = readdir(dirp)) != NULL) {
+		/* Skip "." and "..", and the temporary files of lines_save(). */
+		if (strchr(d->d_name, '.') != NULL ||
+				fstatat(dirfd(dirp), d->d_name, &statbuf, 0) ==
+				-1)
+			continue;
+
+		if (amt == size) {
+			size = size == 0 ? CACHED_SIZE_INIT : size * 2;
+			if ((v = realloc(v, sizeof(*v) * size)) == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		if ((v[amt].name = strdup(d->d_name)) == NULL)
+			err(EXIT_FAILURE, "strdup failed");
+		v[amt].size = statbuf.st_size;
+		v[amt].used = statbuf.st_mtim;
+		total += statbuf.st_size;
+		amt++;
+	}
+
+	if (total > LINES_CACHE_MAX) {
+		qsort(v, amt, sizeof(*v), compare_cached);
+		for (i = 0; i < amt && total > LINES_CACHE_MAX; i++)
+			if (unlinkat(dirfd(dirp), v[i].name, 0) == 0)
+				total -= v[i].size;
+	}
+
+	closedir(dirp);
+
+	for (i = 0; i < amt; i++)
+		free(v[i].name);
+	free(v);
+}
+
+/*
+ * Add the starts of the lines of the 'length' characters at text to li, which
+ * already has those of the first 'from' of them. This is for texts that are
+ * still being read, so that only what has been added to them is looked at.
+ * A line that was at the end of the text before may go on into what has been
+ * added; it is not started again.
+ */
+void
+lines_extend(LineIndex *const li, const char *const text, const long from,
+		const long length)
+{
+	const char *p, *const end = text + length;
+
+	if (from >= length)
+		return;
+
+	if (!li->wide && (unsigned long)length > UINT32_MAX)
+		widen(li);
+
+	/* A newline at the end of the text before was not followed by the
+	 * start of a line until now.
+	 */
+	if (from == 0 || text[from - 1] == '\n')
+		append(li, from);
+
+	for (p = text + from; (p = memchr(p, '\n', end - p)) != NULL &&
+			++p < end; )
+		append(li, p - text);
+}
+
+/*
+ * Return the index of the line that the character at 'offset' is in, by
+ * binary search over li.
+ */
+int
+lines_find(const LineIndex *const li, const long offset)
+{
+	int lo, hi, mid;
+
+	lo = 0;
+	hi = li->amt - 1;
+	while (lo < hi) {
+		mid = lo + (hi - lo + 1) / 2;
+		if (lines_start(li, mid) <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return lo;
+}
+
+/*
+ * Find the amount of lines in the 'length' characters at text, and the
+ * location of all of the starts of lines, and store them in li. Texts of at
+ * least LINES_PARALLEL_MIN characters are indexed on every core at once. Upon
+ * irreconciliable errors, such as running out of memory, the program shall be
+ * exited with code EXIT_FAILURE.
+ */
+void
+lines_index(LineIndex *const li, const char *const text, const long length)
+{
+	lines_index_threads(li, text, length,
+			length >= LINES_PARALLEL_MIN ? pool_cores() : 1);
+}
+
+/*
+ * Index the lines of the 'length' characters at text into li as lines_index()
+ * does, but on 'threads' threads, however long the text is. With one thread,
+ * the text is indexed in a single pass.
+ */
+void
+lines_index_threads(LineIndex *const li, const char *const text,
+		const long length, const int threads)
+{
+	const char *p, *const end = text + length;
+	int n;
+
+	if (li->map != NULL)
+		munmap(li->map, li->maplen);
+	li->map = NULL;
+	li->maplen = 0;
+
+	li->amt = li->size = 0;
+	li->wide = (unsigned long)length > UINT32_MAX;
+	if (li->wide)
+		li->v.wide = NULL;
+	else
+		li->v.narrow = NULL;
+
+	/* Get this edge case out of the way first. */
+	if (length == 0)
+		return;
+
+	if ((n = threads) > 1) {
+		if (n > CHUNKS_MAX)
+			n = CHUNKS_MAX;
+		index_parallel(li, text, length, n);
+		return;
+	}
+
+	/* The first line starts at the first character of the text, so we
+	 * start there.
+	 */
+	append(li, 0);
+
+	/* memchr(3) is much faster than comparing one character at a time;
+	 * C libraries implement it with vector instructions picked for the CPU
+	 * at runtime. Every newline that is not the last character of the text
+	 * is followed by the start of another line.
+	 */
+	for (p = text; (p = memchr(p, '\n', end - p)) != NULL && ++p < end; )
+		append(li, p - text);
+}
+
+/*
+ * Map the cached index of the file described by st from the directory dir
+ * into li, if there is one and the file has not changed since it was made.
+ * Returns 0 on success, or -1 if there is no such index, in which case li is
+ * left alone. Files shorter than LINES_CACHE_MIN characters are never cached.
+ */
+int
+lines_load(LineIndex *const li, const char *const dir,
+		const struct stat *const st)
+{
+	const CacheHeader *h;
+	struct stat statbuf;
+	const char *offsets;
+	char *path;
+	void *p;
+	long width, last;
+	int fd, i;
+
+	if (!S_ISREG(st->st_mode) || st->st_size < LINES_CACHE_MIN)
+		return -1;
+
+	path = cache_name(dir, st);
+	fd = open(path, O_RDONLY);
+	free(path);
+	if (fd == -1)
+		return -1;
+
+	if (fstat(fd, &statbuf) == -1 ||
+			statbuf.st_size < (off_t)sizeof(*h) ||
+			(p = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE,
+				  fd, 0)) == MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+
+	h = p;
+	offsets = (const char *)(h + 1);
+	width = h->wide ? sizeof(*li->v.wide) : sizeof(*li->v.narrow);
+	if (memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0 ||
+			h->version != CACHE_VERSION ||
+			h->dev != (uint64_t)st->st_dev ||
+			h->ino != (uint64_t)st->st_ino ||
+			h->size != (uint64_t)st->st_size ||
+			h->sec != (int64_t)st->st_mtim.tv_sec ||
+			h->nsec != (int64_t)st->st_mtim.tv_nsec ||
+			h->amt < 1 ||
+			(off_t)(sizeof(*h) + width * h->amt) != statbuf.st_size) {
+		munmap(p, statbuf.st_size);
+		close(fd);
+		return -1;
+	}
+
+	/* Mark the index as recently used, for evict(). */
+	futimens(fd, NULL);
+	close(fd);
+
+	li->wide = h->wide;
+	li->amt = h->amt;
+	li->size = 0;
+	if (li->wide)
+		li->v.wide = (long *)offsets;
+	else
+		li->v.narrow = (uint32_t *)offsets;
+	li->map = p;
+	li->maplen = statbuf.st_size;
+
+	/* A damaged index could send scrolling outside of the text, or give a
+	 * line that ends before it starts.
+	 */
+	for (i = 1; i < li->amt; i++)
+		if (lines_start(li, i) <= lines_start(li, i - 1))
+			break;
+	last = lines_start(li, li->amt - 1);
+	if (lines_start(li, 0) != 0 || i < li->amt || last >= st->st_size) {
+		munmap(p, statbuf.st_size);
+		li->map = NULL;
+		li->maplen = 0;
+		li->amt = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Write li, the index of the file described by st, to the cache in the
+ * directory dir, and then evict the least recently used indexes if the cache
+ * has grown too large. Nothing is written for files shorter than
+ * LINES_CACHE_MIN characters. Errors are ignored, as the cache only saves
+ * time.
+ */
+void
+lines_save(const LineIndex *const li, const char *const dir,
+		const struct stat *const st)
+{
+	CacheHeader h;
+	FILE *fp;
+	char *path, *tmp;
+	int fd, failed;
+
+	if (!S_ISREG(st->st_mode) || st->st_size < LINES_CACHE_MIN ||
+			li->map != NULL || li->amt < 1)
+		return;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+	h.version = CACHE_VERSION;
+	h.dev = st->st_dev;
+	h.ino = st->st_ino;
+	h.size = st->st_size;
+	h.sec = st->st_mtim.tv_sec;
+	h.nsec = st->st_mtim.tv_nsec;
+	h.wide = li->wide;
+	h.amt = li->amt;
+
+	path = cache_name(dir, st);
+	if ((tmp = malloc(strlen(path) + sizeof(".XXXXXX"))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	sprintf(tmp, "%s.XXXXXX", path);
+
+	/* The index is written to a temporary file that then replaces the
+	 * old one, so that it is never seen half-written.
+	 */
+	if ((fd = mkstemp(tmp)) != -1) {
+		if ((fp = fdopen(fd, "w")) == NULL) {
+			close(fd);
+			unlink(tmp);
+		} else {
+			fwrite(&h, sizeof(h), 1, fp);
+			if (li->wide)
+				fwrite(li->v.wide, sizeof(*li->v.wide), li->amt,
+						fp);
+			else
+				fwrite(li->v.narrow, sizeof(*li->v.narrow),
+						li->amt, fp);
+			failed = ferror(fp);
+			if (fclose(fp) != 0 || failed ||
+					rename(tmp, path) == -1)
+				unlink(tmp);
+		}
+	}
+
+	free(tmp);
+	free(path);
+
+	evict(dir);
+}
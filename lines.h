@@ -0,0 +1,89 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef LINES_H
+#define LINES_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+/*
+ * An index of where every line in a text starts. This is used in scrolling.
+ *
+ * Lines are stored as offsets from the start of the text rather than as
+ * pointers, so that the index is half the size of an array of pointers, and
+ * stays valid if the text is moved or mapped again. Offsets are 32 bits wide
+ * unless the text is too long for that.
+ */
+typedef struct {
+	/* An array of the offsets of the first character of every line. Which
+	 * member is used depends on wide.
+	 */
+	union {
+		uint32_t *narrow;
+		long *wide;
+	} v;
+
+	/* Whether the text is longer than UINT32_MAX characters, so that
+	 * v.wide is used instead of v.narrow.
+	 */
+	int wide;
+
+	/* How many lines there are in the text. */
+	int amt;
+
+	/* The amount of space allocated for v. */
+	int size;
+
+	/* If v was mapped from the cache by lines_load(), rather than being
+	 * allocated, the mapping and its length; otherwise NULL and 0.
+	 */
+	void *map;
+	long maplen;
+} LineIndex;
+
+void lines_extend(LineIndex *const, const char *const, const long,
+		const long);
+int lines_find(const LineIndex *const, const long);
+void lines_index(LineIndex *const, const char *const, const long);
+void lines_index_threads(LineIndex *const, const char *const, const long,
+		const int);
+int lines_load(LineIndex *const, const char *const, const struct stat *const);
+void lines_save(const LineIndex *const, const char *const,
+		const struct stat *const);
+
+/*
+ * Return the offset of the start of the 'i'-th line.
+ */
+static inline long
+lines_start(const LineIndex *const li, const int i)
+{
+	return li->wide ? li->v.wide[i] : (long)li->v.narrow[i];
+}
+
+/*
+ * Return the offset just past the end of the 'i'-th line, including its
+ * newline, in a text that is 'length' characters long.
+ */
+static inline long
+lines_end(const LineIndex *const li, const int i, const long length)
+{
+	return i + 1 < li->amt ? lines_start(li, i + 1) : length;
+}
+
+#endif /* LINES_H */
@@ -0,0 +1,285 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "lines.h"
+#include "loader.h"
+#include "navipage.h"
+#include "pool.h"
+
+/* How many buffers on either side of the current one are read ahead of time
+ * by the loader's worker threads. See load_buffer().
+ */
+#define READAHEAD 2
+
+static void load_job(void *);
+
+Loader loader = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	PTHREAD_RWLOCK_INITIALIZER,
+	NULL,
+	NULL
+};
+
+/*
+ * Fill the buffer with an error message designated by the arguments.
+ */
+void
+error_buffer(Buffer *const b, const char *format, ...)
+{
+	va_list ap;
+
+	b->size = 128;
+	if ((b->text = malloc(sizeof(*b->text) * b->size)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	va_start(ap, format);
+	vsnprintf(b->text, b->size, format, ap);
+	va_end(ap);
+
+	b->length = strlen(b->text);
+	b->mapped = 0;
+	b->top = 0;
+	lines_index(&b->st, b->text, b->length);
+}
+
+/*
+ * Find where the lines of b start, and where the words of the watchlist are in
+ * it. The lines of a long file, described by st, that has not changed since
+ * it was last read are not found again, but loaded from the cache.
+ */
+void
+index_buffer(Buffer *const b, const struct stat *const st)
+{
+	if (!b->mapped || loader.cache == NULL ||
+			lines_load(&b->st, loader.cache, st) == -1) {
+		lines_index(&b->st, b->text, b->length);
+		if (b->mapped && loader.cache != NULL)
+			lines_save(&b->st, loader.cache, st);
+	}
+
+	watch_buffer(b);
+}
+
+/*
+ * Read the file at path into b, and set various values of b, like length,
+ * top, offset, etc. Regular files are mapped into memory with map_buffer();
+ * anything else, or a file that cannot be mapped, is read with read_buffer().
+ * Returns 0 on success, -1 on error, in which case b is filled with an error
+ * message instead.
+ *
+ * Because this may be called from the read-ahead thread while a buffer is
+ * being displayed, errors are not printed to stderr; the error buffer shows
+ * the message instead.
+ * TODO: Change this function to return a 'Buffer *' and NULL on error.
+ */
+int
+init_buffer(Buffer *const b, const char *const path)
+{
+	struct stat statbuf;
+	char *errfunc;
+	int fd;
+
+	/* Spaces are intentionally used for alignment here because this is an
+	 * odd expression and formatting the usual way with tabs looks worse.
+	 */
+	if ( (errfunc = "open",  (fd = open(path, O_RDONLY)) == -1)  ||
+	     (errfunc = "fstat", fstat(fd, &statbuf) == -1)           ||
+	     (errfunc = "read",  !(S_ISREG(statbuf.st_mode) &&
+	                           map_buffer(b, fd, statbuf.st_size) == 0) &&
+	                         read_buffer(b, fd) == -1) ) {
+		error_buffer(b, "%s: cannot %s %s: %s\n",
+				argv0, errfunc, path, strerror(errno));
+		if (fd != -1)
+			close(fd);
+		return -1;
+	}
+
+	/* A mapping stays valid after its file descriptor is closed. */
+	close(fd);
+
+	b->top = 0;
+
+	index_buffer(b, &statbuf);
+
+	return 0;
+}
+
+/*
+ * Queue every buffer that is not loaded yet to be read by the loader's worker
+ * threads. This is used when all buffers are needed at once, and spreads
+ * reading them over every core.
+ */
+void
+load_all_buffers(void)
+{
+	int i;
+
+	pthread_mutex_lock(&loader.lock);
+	for (i = 0; i < bufl.amt; i++) {
+		if (bufl.v[i]->state == UNLOADED) {
+			bufl.v[i]->state = LOADING;
+			pool_submit(loader.pool, load_job, bufl.v[i]);
+		}
+	}
+	pthread_mutex_unlock(&loader.lock);
+}
+
+/*
+ * Make sure that the 'i'-th buffer is loaded, reading it from its file if a
+ * worker thread has not done so already, and queue the buffers within
+ * READAHEAD of it to be read in the background.
+ */
+void
+load_buffer(const int i)
+{
+	Buffer *const b = bufl.v[i];
+	int j;
+
+	pthread_mutex_lock(&loader.lock);
+
+	/* Queue neighbouring buffers first, so that they can be read while
+	 * this one is. Older buffers come first, as those are the ones that
+	 * are usually moved to next.
+	 */
+	for (j = 1; j <= READAHEAD; j++) {
+		if (i + j < bufl.amt && bufl.v[i + j]->state == UNLOADED) {
+			bufl.v[i + j]->state = LOADING;
+			pool_submit(loader.pool, load_job, bufl.v[i + j]);
+		}
+		if (i - j >= 0 && bufl.v[i - j]->state == UNLOADED) {
+			bufl.v[i - j]->state = LOADING;
+			pool_submit(loader.pool, load_job, bufl.v[i - j]);
+		}
+	}
+
+	/* Wait for a worker thread to finish, if it got here first. */
+	while (b->state == LOADING)
+		pthread_cond_wait(&loader.cond, &loader.lock);
+
+	if (b->state == UNLOADED) {
+		b->state = LOADING;
+		pthread_mutex_unlock(&loader.lock);
+		init_buffer(b, b->key.path);
+		pthread_mutex_lock(&loader.lock);
+		b->state = LOADED;
+		pthread_cond_broadcast(&loader.cond);
+	}
+
+	pthread_mutex_unlock(&loader.lock);
+}
+
+/*
+ * A job run on the loader's worker threads. Reads the buffer at arg, which
+ * must have been marked as LOADING by the submitter, and publishes it.
+ */
+static void
+load_job(void *arg)
+{
+	Buffer *const b = arg;
+
+	/* Errors end up in the buffer itself, through error_buffer(), so the
+	 * return value does not need to be checked.
+	 */
+	init_buffer(b, b->key.path);
+
+	pthread_mutex_lock(&loader.lock);
+	b->state = LOADED;
+	pthread_cond_broadcast(&loader.cond);
+	pthread_mutex_unlock(&loader.lock);
+}
+
+/*
+ * Map the file open at fd, which is 'length' bytes long, into b->text. The
+ * text is then backed by the page cache, rather than being copied onto the
+ * heap. Returns 0 on success, -1 on error.
+ */
+int
+map_buffer(Buffer *const b, const int fd, const off_t length)
+{
+	void *p;
+
+	/* mmap(2) cannot map an empty file, but there is nothing to map. */
+	if (length == 0) {
+		b->text = NULL;
+	} else {
+		p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED)
+			return -1;
+		b->text = p;
+	}
+
+	b->length = length;
+	b->size = 0;
+	b->mapped = 1;
+
+	return 0;
+}
+
+/*
+ * Read everything from fd into b->text. This is used for files that cannot
+ * be mapped, like pipes, whose length is not known ahead of time. Returns 0
+ * on success, -1 on error.
+ */
+int
+read_buffer(Buffer *const b, const int fd)
+{
+	ssize_t n;
+
+	b->length = 0;
+	b->size = TEXT_SIZE_INIT;
+	b->mapped = 0;
+	if ((b->text = malloc(sizeof(*b->text) * b->size)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	for (;;) {
+		/* Double the space whenever it runs out, so that reading a
+		 * long stream does not take a quadratic amount of copying.
+		 */
+		if (b->length == b->size) {
+			b->size *= 2;
+			b->text = realloc(b->text, sizeof(*b->text) * b->size);
+			if (b->text == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+
+		n = read(fd, b->text + b->length, b->size - b->length);
+		if (n == 0)
+			return 0;
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			free(b->text);
+			return -1;
+		}
+		b->length += n;
+	}
+}
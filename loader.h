@@ -0,0 +1,68 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "navipage.h"
+#include "pool.h"
+
+/* How much space is first allocated for a buffer that cannot be mapped. */
+#define TEXT_SIZE_INIT 8192
+
+/*
+ * Coordinates the loading of buffers between the main thread and the worker
+ * threads that read buffers in the background.
+ */
+typedef struct {
+	/* Guards the state of every buffer in bufl. */
+	pthread_mutex_t lock;
+
+	/* Broadcast when a buffer finishes loading. */
+	pthread_cond_t cond;
+
+	/* Held for reading by threads other than the main thread for as long
+	 * as they read the text or lines of a loaded buffer, and for writing
+	 * by the main thread while it adds to them. See grow_buffer().
+	 */
+	pthread_rwlock_t text;
+
+	/* The worker threads that buffers are read on. */
+	Pool *pool;
+
+	/* The directory that the indexes of the lines of long files are cached
+	 * in, or NULL if there is none. See lines_load().
+	 */
+	char *cache;
+} Loader;
+
+extern Loader loader;
+
+void error_buffer(Buffer *const, const char *, ...);
+void index_buffer(Buffer *const, const struct stat *const);
+int init_buffer(Buffer *const, const char *const);
+void load_all_buffers(void);
+void load_buffer(const int);
+int map_buffer(Buffer *const, const int, const off_t);
+int read_buffer(Buffer *const, const int);
+
+#endif /* LOADER_H */
@@ -16,148 +16,214 @@
  * along with this program. If not, see http://www.gnu.org/licenses/.
  */
 
-#include <dirent.h>
 #include <errno.h>
-#include <libgen.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
-#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <readline/readline.h> /* Must be included after stdio.h. */
 #include <readline/history.h>
 #include <stdlib.h>
 #include <string.h>
 #include <termios.h>
+#include <time.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "rogueutil.h"
 
+#include "ac.h"
+#include "discovery.h"
 #include "err.h"
+#include "filekey.h"
+#include "filter.h"
+#include "follow.h"
+#include "frame.h"
+#include "lines.h"
+#include "loader.h"
+#include "navipage.h"
+#include "pattern.h"
+#include "pool.h"
+#include "results.h"
+#include "stream.h"
+
+/* Whether or not frames are drawn as synchronized updates. See config.mk. */
+#ifndef SYNC_UPDATE
+#define SYNC_UPDATE 1
+#endif
+
+/* The least amount of milliseconds between two frames. Input that arrives
+ * in between is handled all at once before the next frame is drawn.
+ */
+#define FRAME_MS 16
+
+/* How many keys can be read from the terminal at once. */
+#define INPUT_SIZE 256
+
+/* How many lines the spans of the matches of the last search are kept for.
+ * This should be more than there are rows on the screen. See
+ * highlight_line().
+ */
+#define HIGHLIGHT_LINES 256
 
-/* TODO: move these defines to appropriate places when main.c is split. */
-#define ST_SIZE_INCR 10
-#define FILEL_SIZE_INCR 4
+/* The escape sequences that draw_line() highlights text with, after turning
+ * off any highlighting before it: the words of the watchlist in bold yellow,
+ * the matches of the last search in reverse video, and text that is both in
+ * both.
+ */
+#define PLAIN_SGR   "\033[m"
+#define WATCH_SGR   "\033[0;1;33m"
+#define MATCH_SGR   "\033[0;7m"
+#define BOTH_SGR    "\033[0;1;33;7m"
 
 #define URL   "https://sr.ht/~smlavine/navipage"
 #define USAGE "Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>\n" \
 	"This program is free software (GPLv3+); see 'man navipage'\n" \
 	"or <" URL "> for more information.\n" \
-	"Usage: navipage [-dhnrsv] files...\n" \
+	"Usage: navipage [-adEhinrsv] files...\n" \
 	"Options:\n" \
+	"    -a  Read all files at startup.\n" \
 	"    -d  Enable debug output.\n" \
+	"    -E  Search with extended regular expressions.\n" \
 	"    -h  Print this help and exit.\n" \
+	"    -i  Ignore case in searches.\n" \
 	"    -n  Display line numbers.\n" \
 	"    -r  Infinitely recurse in directories.\n" \
 	"    -s  Run $NAVIPAGE_SH before reading files.\n" \
 	"    -v  Print version and exit."
 
-enum add_path_recurse_argument {
-	NO_RECURSE = 0,
-	RECURSE = 1
-};
-
 /*
  * Used for certain non-obvious input keys used in input_loop().
  */
 enum key {
 	CTRL_E = '\005', /* Scroll wheel down in st and other terminals. */
-	CTRL_Y = '\031'  /* Scroll wheel up. */
+	CTRL_Y = '\031', /* Scroll wheel up. */
+	ENTER  = '\n'    /* The terminal turns a carriage return into this. */
 };
 
 /*
- * A file buffer. This contains the actual text of the file, but also
- * pointers to the line breaks of the file, which come into use when the file
- * is being scrolled through.
+ * Keys that have been read from the terminal, but not handled yet.
  */
 typedef struct {
-	/* The actual text of the file. */
-	char *text;
-
-	/* The length of the file. */
-	long length;
+	unsigned char v[INPUT_SIZE];
 
-	/* The amount of space allocated for the file. */
-	long size;
+	/* Index of the next key in v to be handled. */
+	int head;
 
-	/* An array of pointers to the first character of every line. This is
-	 * used in scrolling.
-	 */
-	char **st;
-
-	/* How many lines there are in the buffer. */
-	int st_amt;
-
-	/* The amount of space allocated for st. */
-	int st_size;
-
-	/* The variable such that st[top] points to the start of the line that
-	 * is drawn at the top of the screen. See scroll().
-	 */
-	int top;
-} Buffer;
+	/* How many keys there are left to be handled. */
+	int amt;
+} Input;
 
 /*
- * A list of file buffers. Buffers can be switched between during the run of
- * the program.
+ * Where the pattern of the last search is on one line of a buffer. See
+ * Highlights.
  */
 typedef struct {
-	/* The amount of buffers in the list. */
+	/* The line, or -1 if this is not in use. */
+	int line;
+
+	/* The spans of the line that match, in order. */
+	Span *v;
 	int amt;
+	int size;
+} HighlightLine;
 
-	/* Index of the buffer that is currently open to the user. */
-	int n;
+/*
+ * Where the pattern of the last search is on the lines of a buffer that were
+ * drawn recently, so that the matches of a line are only found once while it
+ * stays on the screen. Line i is kept in v[i % HIGHLIGHT_LINES]. See
+ * highlight_line().
+ */
+typedef struct {
+	/* The buffer and pattern that the lines are of. */
+	const Buffer *buffer;
+	Pattern *pattern;
 
-	/* Pointer to the array. */
-	Buffer *v;
-} BufferList;
+	HighlightLine v[HIGHLIGHT_LINES];
+} Highlights;
 
 /*
- * A list of files that will be read into buffers. They are not read into
- * buffers immediately because not all will be necessary.
+ * The pattern last searched for with '/' or '?', and where it was last found.
  */
 typedef struct {
-	/* The amount of files in the list. */
-	int amt;
-
-	/* The amount of space allocated for the array. */
-	int size;
+	/* The pattern, or NULL if nothing has been searched for yet. */
+	Pattern *pattern;
 
-	/* The amount of allocated space that is being used for the array. */
-	int used;
+	/* Whether the last search was backward, with '?'. */
+	int backward;
 
-	/* Pointer to the array. */
-	char **v;
-} FileList;
+	/* The buffer and line that the pattern was last found at, and the
+	 * index of that line in the matches of the buffer.
+	 */
+	const Buffer *buffer;
+	int line;
+	int hit;
+} Search;
 
+/* Warnings from threads other than the main thread, which are held back while
+ * the screen is drawn on. See defer_warnings().
+ */
 typedef struct {
-	unsigned int debug:1;
-	unsigned int numbers:1;
-	unsigned int recurse_more:1;
-	unsigned int sh:1;
-} Flags;
+	pthread_mutex_t lock;
+
+	/* The thread whose warnings are printed at once. */
+	pthread_t main;
+
+	/* The warnings held back, one after another, of which there are 'len'
+	 * characters, with room for 'size'.
+	 */
+	char *v;
+	size_t len, size;
+} Warnings;
 
 /* Function prototypes. */
-static int add_directory(const char *const, const int);
-static int add_path(const char *const, const int);
 static int change_buffer(const int);
 static void cleanup_display(void);
 static void clear_current_line(void);
-static int compare_path_basenames(const void *, const void *);
+static long clock_ms(void);
+static void defer_warnings(void);
+static void display(void);
 static void display_buffer(const Buffer *const);
-static void error_buffer(Buffer *const, const char *, ...);
+static void display_filtering(void);
+static void display_lines(const Buffer *const);
+static void display_results(void);
+static void draw_line(const Buffer *const, const int);
 static void execute_command(void);
+static void find_matches(Buffer *const, Pattern *const);
+static int find_next(const int);
+static long find_span(const Span *const, const long, const long);
+static int get_key(void);
+static const Span *highlight_line(const Buffer *const, const int,
+		int *const);
+static void handle_bus(int, siginfo_t *, void *);
 static void handle_signals(const int);
+static void hold_warning(const char *);
 static void info(void);
-static int init_buffer(Buffer *const, const char *const);
 static void input_loop(void);
+static int lines_fit(const Buffer *const, const int, const int);
+static void load_watchlist(const char *const);
+static void move(const int, const int);
+static void open_result(void);
+static void print_warnings(void);
+static char *prompt(const char *const);
+static long put_fitted(const char *const, const long, const long);
+static int read_input(const int);
+static int readline_get_key(FILE *);
 static void redraw(void);
 static void restore_terminal(void);
+static int results_key(const int);
 static int scroll(const int);
 static void scroll_to_top(void);
 static void scroll_to_bottom(void);
+static void start_filter(void);
+static void start_search(const int);
+static int take_key(void);
 static void toggle_numbers(void);
-static void update_rows(void);
+static void update_size(void);
 static void update_terminal(void);
 static void usage(void);
 static void version(void);
@@ -175,114 +241,113 @@ int ttyno;
 struct termios original_term, reading_input_term;
 
 Flags flags;
+Input input;
+Search search;
+Highlights highlights;
 FileList filel;
 BufferList bufl;
-int rows;
+int rows, cols;
 
-/*
- * Append the files in the directory called path to filel. Return value shall
- * be 0 on success, and -1 on error. Upon irreconciliable errors, such as
- * running out of memory, the program shall be exited with code EXIT_FAILURE.
+/* A pipe that worker threads write to, to wake the main thread up when they
+ * have something new for it to draw. See wake_up().
  */
-static int
-add_directory(const char *const path, const int recurse)
-{
-	struct dirent *d;
-	DIR *dirp;
-	char *newpath;
-
-	if ((dirp = opendir(path)) == NULL)
-		return (ewarn("cannot opendir %s", path), -1);
+int wakefd[2] = { -1, -1 };
 
-	/* Reset errno in order to detect readdir/closedir errors. */
-	errno = 0;
-	while ((d = readdir(dirp)) != NULL) {
-		/* Exclude "." and ".." to avoid infinite recursion. */
-		if (strcmp(d->d_name, ".") == 0 ||
-				strcmp(d->d_name, "..") == 0)
-			continue;
-
-		/* TODO: look into using nftw() */
+/* Set by read_input() when woken up through wakefd. */
+int woken;
 
-		newpath = malloc(sizeof(*newpath) *
-				(strlen(path) + strlen(d->d_name) + 2));
-		if (newpath == NULL)
-			err(EXIT_FAILURE, "malloc failed");
-		sprintf(newpath, "%s/%s", path, d->d_name);
-
-		add_path(newpath, recurse);
+/* /dev/zero, open for reading, and the size of a page of memory. See
+ * handle_bus().
+ */
+int zerofd = -1;
+long pagesize;
 
-		free(newpath);
-	}
-	if (errno != 0)
-		return (ewarn("cannot readdir %s", path), -1);
+/* Set by handle_bus() when a mapped file has got shorter than its buffer. */
+volatile sig_atomic_t truncated;
 
-	closedir(dirp);
+/* See defer_warnings(). */
+Warnings warnings = { PTHREAD_MUTEX_INITIALIZER, 0, NULL, 0, 0 };
 
-	return 0;
-}
+/* The frame being drawn. See display_buffer(). */
+Frame frame = { NULL, 0, 0, SYNC_UPDATE, NULL, 0, 0, 0 };
 
-/*
- * Append the file at path to filel. If path is a directory, and recurse is
- * nonzero, then all files in path will be added to filel through
- * add_directory(). Return value shall be 0 on success, and -1 on error. Upon
- * irreconciliable errors, such as running out of memory, the program shall be
- * exited with code EXIT_FAILURE.
+/* The buffer shown on the screen, and the line of it at the top, as of the
+ * last frame drawn by display_buffer().
  */
-static int
-add_path(const char *path, const int recurse)
-{
-	struct stat statbuf;
-
-	if (stat(path, &statbuf) == -1)
-		return (ewarn("cannot stat %s", path), -1);
+const Buffer *shown;
+int shown_top;
 
-	if (S_ISDIR(statbuf.st_mode))
-		return recurse ? add_directory(path, recurse) :
-			(warn("no -r; omitting directory %s\n", path), -1);
+/* Whether a trigram index is kept of the files at $NAVIPAGE_DIR. See
+ * index_files().
+ */
+int indexed;
 
-	if (!S_ISREG(statbuf.st_mode))
-		return (warn("cannot read %s: not a regular file\n", path), -1);
+/* The words of $NAVIPAGE_WATCHLIST, and whether there are any. See
+ * load_watchlist().
+ */
+Automaton watchlist;
+int watching;
 
-	/* Add file path to the list. */
+/* The buffer whose filter is being typed at the prompt of start_filter(), or
+ * NULL.
+ */
+Buffer *filtering;
 
-	/* Make sure that there is enough space allocated in filel for a new
-	 * pointer.
-	 */
-	while (filel.size < filel.used)
-		filel.size += sizeof(*filel.v) * FILEL_SIZE_INCR;
+/* A message to show in the status bar instead of the usual information, until
+ * the next key is pressed; or NULL.
+ */
+const char *message;
 
-	if ((filel.v = realloc(filel.v, filel.size)) == NULL)
-		err(EXIT_FAILURE, "realloc failed");
+/*
+ * Return the path of the file called name in the cache directory of navipage,
+ * which is $XDG_CACHE_HOME/navipage, or ~/.cache/navipage, creating the
+ * directory if it does not exist yet. Returns NULL if there is no home
+ * directory to put it in. The path must be freed by the caller.
+ */
+char *
+cache_path(const char *const name)
+{
+	const char *base, *sub;
+	char *path;
+
+	sub = "";
+	if ((base = getenv("XDG_CACHE_HOME")) == NULL || base[0] != '/') {
+		if ((base = getenv("HOME")) == NULL || base[0] == '\0')
+			return NULL;
+		sub = "/.cache";
+	}
 
-	/* Allocate space for file path. */
-	filel.v[filel.amt] = malloc(sizeof(*filel.v[filel.amt]) *
-			(1 + strlen(path)));
-	if (filel.v[filel.amt] == NULL)
+	path = malloc(strlen(base) + strlen(sub) + strlen("/navipage/") +
+			strlen(name) + 1);
+	if (path == NULL)
 		err(EXIT_FAILURE, "malloc failed");
 
-	filel.used += sizeof(*filel.v);
-
-	/* Add the file path! */
-	strcpy(filel.v[filel.amt], path);
-	filel.amt++;
+	/* mkdir(2) fails harmlessly on directories that already exist. */
+	sprintf(path, "%s%s", base, sub);
+	mkdir(path, 0700);
+	strcat(path, "/navipage");
+	mkdir(path, 0700);
+	strcat(path, "/");
+	strcat(path, name);
 
-	return 0;
+	return path;
 }
 
 /*
  * Move to the 0-indexed 'new'-th buffer. That is, change_buffer(0) will switch
  * to the first buffer, etc. If the operation is successful, meaning the new
  * value is in the range of possible indices, then 0 is returned; otherwise,
- * the value that bufl.n would have been set to is returned.
+ * the value that bufl.n would have been set to is returned. The buffer is
+ * drawn by the next frame of input_loop().
  */
 static int
 change_buffer(const int new)
 {
 	if (new >= 0 && new < bufl.amt) {
+		load_buffer(new);
+		if (new != bufl.n)
+			bufl.moved = 1;
 		bufl.n = new;
-		cls();
-		display_buffer(&bufl.v[bufl.n]);
 		return 0;
 	}
 
@@ -323,107 +388,314 @@ clear_current_line(void)
 }
 
 /*
- * Compares two file paths by their basename. Of importance to us is that files
- * named in YYYYMMDD format are compared such that the file named with the
- * further date is "less than" the other path. Return value shall be the
- * negative of what strcmp() would return given the basename of the paths.
- * Upon irreconciliable errors, such as running out of memory, the program
- * shall be exited with code EXIT_FAILURE.
+ * Return the time in milliseconds on a clock that only ever goes forward.
  */
-static int
-compare_path_basenames(const void *p1, const void *p2)
-{
-	/* To quote the Linux man page for qsort(3):
-	 *     The actual arguments to this function are "pointers to
-	 *     pointers to char", but strcmp(3) arguments are "pointers to
-	 *     char", hence the following cast plus dereference.
-	 * See <https://www.man7.org/linux/man-pages/man3/qsort.3.html>, or
-	 * `man 3 qsort`.
-	 */
-	const char **strp1 = (const char **)p1, **strp2 = (const char **)p2;
-	/* POSIX-compliant basename() may modify the path variable, which we
-	 * don't want. For this reason, we copy the string before passing it to
-	 * basename().
-	 */
-	char *copy1, *copy2;
-	int ret;
+static long
+clock_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
-	copy1 = strdup(*strp1);
-	copy2 = strdup(*strp2);
-	if (copy1 == NULL || copy2 == NULL)
-		err(EXIT_FAILURE, "strdup failed");
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-	ret = -strcmp(basename(copy1), basename(copy2));
+/*
+ * Return the pattern source, compiled for the flags given to the program.
+ * It must be given back with pattern_put(). If it is an invalid regex,
+ * message is set to say why, and NULL is returned.
+ */
+Pattern *
+compile_pattern(const char *const source)
+{
+	static char error[128];
+	Pattern *p;
 
-	free(copy1);
-	free(copy2);
+	p = pattern_get(source, (flags.icase ? PATTERN_ICASE : 0) |
+			(flags.regex ? PATTERN_REGEX : 0),
+			error, sizeof(error));
+	if (p == NULL)
+		message = error;
 
-	return ret;
+	return p;
 }
 
 /*
- * Display all text from b->st[b->top] to the end of the screen.
+ * Hold back the warnings of every thread but the calling one, such as those
+ * about files that are found in the background, through hold_warning(), so
+ * that they are neither drawn over the screen nor cleared with it. They are
+ * printed by print_warnings(), once the terminal has been restored.
+ */
+static void
+defer_warnings(void)
+{
+	warnings.main = pthread_self();
+	warn_hook = hold_warning;
+}
+
+/*
+ * Draw the results of the last search of every buffer if they are open, or
+ * else the current buffer.
+ */
+static void
+display(void)
+{
+	if (results.open)
+		display_results();
+	else
+		display_buffer(bufl.v[bufl.n]);
+}
+
+/*
+ * Display all text from the start of line b->top to the end of the screen,
+ * and the status bar below it.
  */
 static void
 display_buffer(const Buffer *const b)
 {
-	int i, linestoprint;
+	frame_begin(&frame);
+
+	display_lines(b);
+
+	/* Print status-bar information. */
+	frame_row_begin(&frame, rows);
+	if (message != NULL)
+		frame_puts(&frame, message);
+	else if (b->filter.pattern != NULL)
+		frame_printf(&frame, "#%d/%d%s %s &%s: %d lines",
+				bufl.n + 1, bufl.amt,
+				discovery.settled ? "" : "+", filel.v[bufl.n],
+				pattern_source(b->filter.pattern),
+				b->filter.amt);
+	else
+		frame_printf(&frame, "#%d/%d%s %s",
+				bufl.n + 1, bufl.amt,
+				discovery.settled ? "" : "+", filel.v[bufl.n]);
+	if (message == NULL && watching)
+		frame_printf(&frame, " (%ld watched)", b->watched.hits);
+	if (message == NULL && follow.buffer == b)
+		frame_puts(&frame, " (following)");
+	frame_row_end(&frame, rows);
+
+	frame_flush(&frame, STDOUT_FILENO);
+
+	shown = b;
+	shown_top = b->top;
+}
+
+/*
+ * Draw the lines of the buffer being filtered as its pattern is typed,
+ * leaving the prompt in the status bar as readline drew it. Nothing is drawn
+ * if a line might wrap, as that could scroll the prompt away.
+ */
+static void
+display_filtering(void)
+{
+	const Buffer *const b = filtering;
+
+	if (!lines_fit(b, b->top, b->top + rows - 2))
+		return;
+
+	frame_begin(&frame);
 
-	gotoxy(1, 1);
+	/* Save the position and colors of the cursor in the prompt, and draw
+	 * the lines in the usual colors.
+	 */
+	frame_puts(&frame, "\0337\033[m");
+	display_lines(b);
+	frame_puts(&frame, "\0338");
+
+	frame_flush(&frame, STDOUT_FILENO);
+
+	shown = b;
+	shown_top = b->top;
+}
+
+/*
+ * Add the lines of b from b->top to the bottom of the screen to the frame,
+ * leaving out the status bar.
+ *
+ * Only the rows of the screen that change are drawn. If b was already being
+ * shown, but scrolled to a different line, then the lines that are still on
+ * the screen are moved by the terminal instead of being drawn again. This
+ * all relies on no line wrapping onto the next row, so if any might, the
+ * whole screen is drawn instead, one line after the other.
+ */
+static void
+display_lines(const Buffer *const b)
+{
+	int i, linestoprint;
 
 	/* The amount of lines to be printed in this call. Print `rows - 1`
 	 * (the height of the screen, not including the status bar), but only
 	 * print the amount of lines in the file if that is less than
 	 * `rows - 1`, to avoid a segfault.
 	 */
-	linestoprint = (b->st_amt < rows - 1 ? b->st_amt : rows - 1);
-
-	for (i = 0; i < linestoprint; i++) {
-		int linelen;
-		char *eolptr;
+	linestoprint = view_amt(b) - b->top;
+	if (linestoprint > rows - 1)
+		linestoprint = rows - 1;
+
+	if (lines_fit(b, b->top, b->top + linestoprint - 1)) {
+		if (shown == b)
+			frame_scroll(&frame, 1, rows - 1, b->top - shown_top);
+
+		for (i = 0; i < rows - 1; i++) {
+			frame_row_begin(&frame, i + 1);
+			if (i < linestoprint)
+				draw_line(b, view_line(b, b->top + i));
+			frame_row_end(&frame, i + 1);
+		}
+	} else {
+		/* What the rows show is not known once lines wrap. */
+		frame_invalidate(&frame);
+
+		frame_goto(&frame, 1, 1);
+		for (i = 0; i < linestoprint; i++) {
+			frame_puts(&frame, "\033[2K");
+			draw_line(b, view_line(b, b->top + i));
+			frame_puts(&frame, "\n");
+		}
 
-		/* Find the location of the end of the line, or if an eol
-		 * cannot be found, then it is the last line in the file
-		 * and we should find the eof.
+		/* Clear the rest of the screen, if the buffer doesn't fill
+		 * it.
 		 */
-		if ((eolptr = strchr(b->st[b->top + i], '\n')) == NULL)
-			eolptr = strchr(b->st[b->top + i], '\0');
-
-		linelen = eolptr - b->st[b->top + i] + 1;
-
-		clear_current_line();
-
-		/* Print the line number at the start of each line. */
-		if (flags.numbers)
-			printf("%3d ", b->top + i + 1);
+		frame_puts(&frame, "\033[J");
+	}
+}
 
-		fwrite(b->st[b->top + i], sizeof(char), linelen, stdout);
+/*
+ * Display the results of the last search of every buffer, one line to a row,
+ * with the selected one in reverse video. More are drawn as they come in from
+ * the worker threads.
+ */
+static void
+display_results(void)
+{
+	const Result *r;
+	char number[64];
+	long width;
+	int i;
+
+	pthread_mutex_lock(&results.lock);
+
+	/* Keep the selected result on the screen. */
+	if (results.sel < results.top)
+		results.top = results.sel;
+	else if (results.sel > results.top + rows - 2)
+		results.top = results.sel - rows + 2;
+
+	frame_begin(&frame);
+
+	for (i = 0; i < rows - 1; i++) {
+		frame_row_begin(&frame, i + 1);
+		if (results.top + i < results.amt) {
+			r = &results.v[results.top + i];
+			if (results.top + i == results.sel)
+				frame_puts(&frame, "\033[7m");
+
+			snprintf(number, sizeof(number), ":%d: ", r->line + 1);
+			width = cols;
+			width -= put_fitted(filel.v[r->buffer],
+					strlen(filel.v[r->buffer]), width);
+			width -= put_fitted(number, strlen(number), width);
+			put_fitted(r->text, strlen(r->text), width);
+
+			if (results.top + i == results.sel)
+				frame_puts(&frame, "\033[m");
+		}
+		frame_row_end(&frame, i + 1);
 	}
 
 	/* Print status-bar information. */
-	gotoxy(1, rows);
-	printf("#%d/%d %s", bufl.n + 1, bufl.amt, filel.v[bufl.n]);
+	frame_row_begin(&frame, rows);
+	if (message != NULL)
+		frame_puts(&frame, message);
+	else {
+		/* A status bar that wraps would scroll the screen. */
+		snprintf(number, sizeof(number), ": %d lines in %d/%d files",
+				results.amt, results.done, results.files);
+		width = cols;
+		width -= put_fitted("/*", 2, width);
+		width -= put_fitted(pattern_source(results.pattern),
+				strlen(pattern_source(results.pattern)),
+				width - (long)strlen(number));
+		put_fitted(number, strlen(number), width);
+	}
+	frame_row_end(&frame, rows);
 
-	fflush(stdout);
+	pthread_mutex_unlock(&results.lock);
+
+	frame_flush(&frame, STDOUT_FILENO);
+
+	/* The rows no longer show a buffer that display_buffer() can scroll. */
+	shown = NULL;
 }
 
 /*
- * Fill the buffer with an error message designated by the arguments.
+ * Add the 'i'-th line of b to the frame at the position of the cursor, with
+ * its line number if those are turned on. The newline at the end of the line
+ * is left out.
  */
 static void
-error_buffer(Buffer *const b, const char *format, ...)
+draw_line(const Buffer *const b, const int i)
 {
-	va_list ap;
+	static const char *const sgr[] = {
+		PLAIN_SGR, WATCH_SGR, MATCH_SGR, BOTH_SGR
+	};
+	const Span *mv;
+	long start, end, pos, next, w;
+	int m, mamt, state, newstate;
+
+	start = lines_start(&b->st, i);
+	end = lines_end(&b->st, i, b->length);
+	if (end > start && b->text[end - 1] == '\n')
+		end--;
+
+	/* Print the line number at the start of each line. */
+	if (flags.numbers)
+		frame_printf(&frame, "%3d ", i + 1);
+
+	/* Highlight the words of the watchlist, which were found when the
+	 * buffer was read, and the matches of the last search. The text is
+	 * put in pieces that are each highlighted the same way, with an
+	 * escape sequence wherever that changes.
+	 */
+	w = find_span(b->watched.v, b->watched.amt, start);
+	mv = highlight_line(b, i, &mamt);
+	m = 0;
+	state = 0;
+	for (pos = start; pos < end; pos = next) {
+		next = end;
+		newstate = 0;
+
+		while (w < b->watched.amt && b->watched.v[w].end <= pos)
+			w++;
+		if (w < b->watched.amt && b->watched.v[w].start <= pos) {
+			newstate |= 1;
+			if (b->watched.v[w].end < next)
+				next = b->watched.v[w].end;
+		} else if (w < b->watched.amt && b->watched.v[w].start < next) {
+			next = b->watched.v[w].start;
+		}
 
-	b->size = 128;
-	if ((b->text = malloc(sizeof(*b->text) * b->size)) == NULL)
-		err(EXIT_FAILURE, "malloc failed");
+		while (m < mamt && mv[m].end <= pos)
+			m++;
+		if (m < mamt && mv[m].start <= pos) {
+			newstate |= 2;
+			if (mv[m].end < next)
+				next = mv[m].end;
+		} else if (m < mamt && mv[m].start < next) {
+			next = mv[m].start;
+		}
 
-	va_start(ap, format);
-	vsnprintf(b->text, b->size, format, ap);
-	va_end(ap);
+		if (newstate != state)
+			frame_puts(&frame, sgr[newstate]);
+		state = newstate;
+		frame_put(&frame, b->text + pos, next - pos);
+	}
 
-	b->length = strlen(b->text);
+	if (state != 0)
+		frame_puts(&frame, PLAIN_SGR);
 }
 
 /*
@@ -435,18 +707,9 @@ execute_command(void)
 	const color_code EC_COLOR = YELLOW; /* EC short for execute_command */
 	char *line;
 
-	/* Clear the status line before showing the command prompt. */
-	gotoxy(1, rows);
-	clear_current_line();
-
-	/* We want to be able to see characters entered in readline. */
-	restore_terminal();
-
-	setColor(EC_COLOR); /* Display readline prompt in EC_COLOR */
-	rl_instream = tty;
-	if ((line = readline("!")) != NULL) {
-		resetColor();
-		fflush(stdout);
+	if ((line = prompt("!")) != NULL) {
+		/* Let the command use the terminal as it normally would. */
+		restore_terminal();
 		system(line);
 		free(line);
 	}
@@ -457,13 +720,274 @@ execute_command(void)
 	/* -1 means to use the current background color. */
 	colorPrint(EC_COLOR, -1, "navipage: press any key to return.");
 	fflush(stdout);
-	getc(tty); /* can't use anykey(NULL) because it reads from stdin */
+	get_key(); /* can't use anykey(NULL) because it reads from stdin */
 
 	resetColor();
-	display_buffer(&bufl.v[bufl.n]);
+	/* The command could have drawn anything on the screen. */
+	frame_invalidate(&frame);
+	display();
 	/* fflush(stdout) -- unneeded, is ran at the end of display_buffer() */
 }
 
+/*
+ * Find every line of b that has the pattern p, unless that has been done
+ * already, and keep them in b->matches.
+ */
+static void
+find_matches(Buffer *const b, Pattern *const p)
+{
+	Matches *const m = &b->matches;
+	int i;
+
+	if (m->pattern == p)
+		return;
+
+	if (m->pattern != NULL)
+		pattern_put(m->pattern);
+	free(m->v);
+	free(m->bits);
+
+	m->pattern = pattern_keep(p);
+	match_lines(b, p, 0, NULL, 0, &m->v, &m->amt, NULL);
+
+	if ((m->bits = calloc(b->st.amt / 8 + 1, 1)) == NULL)
+		err(EXIT_FAILURE, "calloc failed");
+	for (i = 0; i < m->amt; i++)
+		m->bits[m->v[i] / 8] |= 1 << m->v[i] % 8;
+}
+
+/*
+ * Find the next line with the pattern of the last search in the current
+ * buffer, after the line it was last found on if that is still on the screen,
+ * or else from the top of the screen, and scroll to it. If backward is
+ * nonzero, the previous line with the pattern is found instead. Returns 0 if
+ * the pattern is found; otherwise message is set, and -1 is returned.
+ *
+ * The lines with the pattern are found once, by find_matches(), so moving
+ * from one to the next does not search the text again.
+ */
+static int
+find_next(const int backward)
+{
+	Buffer *const b = bufl.v[bufl.n];
+	const Matches *m;
+	int line, onscreen, hit, lo, hi, mid, pos;
+
+	if (search.pattern == NULL) {
+		message = "No previous search pattern";
+		return -1;
+	}
+
+	find_matches(b, search.pattern);
+	m = &b->matches;
+
+	pos = view_find(b, search.line);
+	onscreen = search.buffer == b && pos < view_amt(b) &&
+		view_line(b, pos) == search.line &&
+		pos >= b->top && pos < b->top + rows - 1;
+	if (onscreen)
+		line = search.line;
+	else
+		line = b->top < view_amt(b) ? view_line(b, b->top) : 0;
+
+	if (onscreen && search.hit >= 0 && search.hit < m->amt &&
+			m->v[search.hit] == line) {
+		/* Step from the last match found. */
+		hit = search.hit + (backward ? -1 : 1);
+	} else {
+		/* Find the first match on or after the line. */
+		lo = 0;
+		hi = m->amt;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (m->v[mid] < line)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (backward)
+			hit = lo - 1;
+		else if (onscreen && lo < m->amt && m->v[lo] == line)
+			hit = lo + 1;
+		else
+			hit = lo;
+	}
+
+	/* Pass over lines that are filtered out. */
+	while (hit >= 0 && hit < m->amt &&
+			((pos = view_find(b, m->v[hit])) == view_amt(b) ||
+			 view_line(b, pos) != m->v[hit]))
+		hit += backward ? -1 : 1;
+
+	if (hit < 0 || hit >= m->amt) {
+		message = "Pattern not found";
+		return -1;
+	}
+
+	search.buffer = b;
+	search.line = m->v[hit];
+	search.hit = hit;
+	b->top = pos < max_top(b) ? pos : max_top(b);
+
+	return 0;
+}
+
+/*
+ * Return the index of the first of the 'amt' sorted spans at v that ends after
+ * off, or amt if there is none.
+ */
+static long
+find_span(const Span *const v, const long amt, const long off)
+{
+	long lo, hi, mid;
+
+	lo = 0;
+	hi = amt;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (v[mid].end <= off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * Return the next key from the terminal, waiting for one if there is none.
+ */
+/*
+ * Forget where the pattern of the last search is on the lines of b, if that is
+ * what is kept, so that it is found again when they are drawn.
+ */
+void
+forget_highlights(const Buffer *const b)
+{
+	if (highlights.buffer == b)
+		highlights.buffer = NULL;
+}
+
+static int
+get_key(void)
+{
+	int c;
+
+	while ((c = take_key()) == EOF)
+		read_input(-1);
+
+	return c;
+}
+
+/*
+ * Find the lines, words of the watchlist, and matches of the filter and the
+ * last search in the text that has been added to b after its first 'old'
+ * bytes. The line that was last before may go on into the new text, so it is
+ * looked at again. If b is being followed and was scrolled to the bottom, it
+ * is kept there. This must be called with loader.text held for writing.
+ */
+void
+grow_buffer(Buffer *const b, const long old)
+{
+	Matches *const m = &b->matches;
+	Watched *const w = &b->watched;
+	Span *v;
+	long start, amt;
+	int bottom, first, i, oldlines;
+
+	if (b->length == old)
+		return;
+
+	bottom = b->top >= max_top(b);
+	oldlines = b->st.amt;
+	lines_extend(&b->st, b->text, old, b->length);
+
+	first = old == 0 ? 0 : lines_find(&b->st, old - 1) +
+		(b->text[old - 1] == '\n');
+	start = lines_start(&b->st, first);
+
+	if (b->filter.pattern != NULL)
+		add_lines(b, b->filter.pattern, old, &b->filter.v,
+				&b->filter.amt);
+
+	if (m->pattern != NULL) {
+		i = add_lines(b, m->pattern, old, &m->v, &m->amt);
+		if ((m->bits = realloc(m->bits, b->st.amt / 8 + 1)) == NULL)
+			err(EXIT_FAILURE, "realloc failed");
+		memset(m->bits + oldlines / 8 + 1, 0,
+				b->st.amt / 8 - oldlines / 8);
+		if (first < oldlines)
+			m->bits[first / 8] &= ~(1 << first % 8);
+		for (; i < m->amt; i++)
+			m->bits[m->v[i] / 8] |= 1 << m->v[i] % 8;
+	}
+
+	if (watching) {
+		while (w->amt > 0 && w->v[w->amt - 1].start >= start)
+			w->amt--;
+		w->hits -= ac_find(&watchlist, b->text + start, old - start,
+				&v, &amt);
+		free(v);
+		w->hits += ac_find(&watchlist, b->text + start,
+				b->length - start, &v, &amt);
+		if ((w->v = realloc(w->v, sizeof(*w->v) * (w->amt + amt + 1)))
+				== NULL)
+			err(EXIT_FAILURE, "realloc failed");
+		for (i = 0; i < amt; i++) {
+			w->v[w->amt].start = v[i].start + start;
+			w->v[w->amt].end = v[i].end + start;
+			w->amt++;
+		}
+		free(v);
+	}
+
+	if (highlights.buffer == b &&
+			highlights.v[first % HIGHLIGHT_LINES].line == first)
+		highlights.v[first % HIGHLIGHT_LINES].line = -1;
+
+	if (bottom && follow.buffer == b)
+		b->top = max_top(b);
+}
+
+/*
+ * Handle SIGBUS, which is raised when a page of a mapped buffer that is past
+ * the end of its file is read, because the file has got shorter since it was
+ * mapped. The page is mapped over with one of zeros, so that it reads as null
+ * characters instead of killing the program, and the main thread is woken up
+ * to say so. Any other SIGBUS is fatal, but the terminal is restored first.
+ */
+static void
+handle_bus(int sig, siginfo_t *info, void *context)
+{
+	static const char show_cursor[] = "\033[?25h";
+	const int saved = errno;
+	char *page;
+
+	(void)context;
+
+	if (info->si_code == BUS_ADRERR && zerofd != -1) {
+		page = (char *)info->si_addr -
+			(uintptr_t)info->si_addr % pagesize;
+		if (mmap(page, pagesize, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+					zerofd, 0) != MAP_FAILED) {
+			truncated = 1;
+			wake_up();
+			errno = saved;
+			return;
+		}
+	}
+
+	/* Only functions that are safe to call from a signal handler may be
+	 * used here, so restore_terminal() cannot be.
+	 */
+	tcsetattr(ttyno, TCSANOW, &original_term);
+	while (write(STDOUT_FILENO, show_cursor, sizeof(show_cursor) - 1) ==
+			-1 && errno == EINTR)
+		;
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
 /*
  * Handle signals.
  */
@@ -483,6 +1007,109 @@ handle_signals(int sig)
 	}
 }
 
+/*
+ * Return the spans of line i of b that match the pattern of the last search,
+ * and store how many there are at *amt. They are found the first time that
+ * the line is drawn, and kept until the pattern changes or another buffer is
+ * drawn.
+ */
+static const Span *
+highlight_line(const Buffer *const b, const int i, int *const amt)
+{
+	HighlightLine *const h = &highlights.v[i % HIGHLIGHT_LINES];
+	long off, end, start, lineend;
+	int n;
+
+	*amt = 0;
+	if (search.pattern == NULL)
+		return NULL;
+
+	if (highlights.buffer != b || highlights.pattern != search.pattern) {
+		for (n = 0; n < HIGHLIGHT_LINES; n++)
+			highlights.v[n].line = -1;
+		if (highlights.pattern != NULL)
+			pattern_put(highlights.pattern);
+		highlights.buffer = b;
+		highlights.pattern = pattern_keep(search.pattern);
+	}
+
+	if (h->line == i) {
+		*amt = h->amt;
+		return h->v;
+	}
+
+	h->line = i;
+	h->amt = 0;
+
+	/* The lines with a match are already known if the buffer has been
+	 * searched for the pattern.
+	 */
+	if (b->matches.pattern == search.pattern &&
+			!(b->matches.bits[i / 8] & 1 << i % 8))
+		return NULL;
+
+	start = lines_start(&b->st, i);
+	lineend = lines_end(&b->st, i, b->length);
+	if (lineend > start && b->text[lineend - 1] == '\n')
+		lineend--;
+
+	for (off = start; (off = pattern_next(search.pattern, b->text, off,
+					lineend, &end)) != -1; off = end) {
+		/* An empty match has nothing to highlight. */
+		if (end == off) {
+			end = off + 1;
+			continue;
+		}
+
+		if (h->amt == h->size) {
+			h->size = h->size == 0 ? 4 : h->size * 2;
+			if ((h->v = realloc(h->v, sizeof(*h->v) * h->size)) ==
+					NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		h->v[h->amt].start = off;
+		h->v[h->amt].end = end;
+		h->amt++;
+	}
+
+	*amt = h->amt;
+	return h->v;
+}
+
+/*
+ * Add the warning msg to those printed by print_warnings(), unless it is from
+ * the main thread, which prints it at once. This is the warn_hook set by
+ * defer_warnings().
+ */
+static void
+hold_warning(const char *msg)
+{
+	const size_t len = strlen(msg);
+	size_t size;
+	char *v;
+
+	if (pthread_equal(pthread_self(), warnings.main)) {
+		fputs(msg, stderr);
+		return;
+	}
+
+	pthread_mutex_lock(&warnings.lock);
+	if (warnings.len + len > warnings.size) {
+		size = (warnings.len + len) * 2;
+
+		/* If there is no memory for it, the warning is lost. */
+		if ((v = realloc(warnings.v, size)) == NULL) {
+			pthread_mutex_unlock(&warnings.lock);
+			return;
+		}
+		warnings.v = v;
+		warnings.size = size;
+	}
+	memcpy(warnings.v + warnings.len, msg, len);
+	warnings.len += len;
+	pthread_mutex_unlock(&warnings.lock);
+}
+
 /*
  * Display helpful information in the following order, with the next option
  * being tried if the first fails:
@@ -494,6 +1121,9 @@ handle_signals(int sig)
 static void
 info(void)
 {
+	/* Whatever is shown here is drawn outside of the frame. */
+	frame_invalidate(&frame);
+
 	if (system("man 1 navipage")   == 0) return;
 	if (system("man ./navipage.1") == 0) return;
 	if (system("less README.md")   == 0) return;
@@ -506,154 +1136,537 @@ info(void)
 }
 
 /*
- * Read the file at path into b, and set various values of b, like length,
- * top, offset, etc. Returns 0 on success, -1 on error.
- * TODO: Change this function to return a 'Buffer *' and NULL on error.
+ * The main input loop.
+ *
+ * All keys that are waiting to be read are handled before the screen is
+ * drawn again, and runs of scrolling or of moving between buffers are
+ * carried out as one movement; see move(). That way, a burst of input like
+ * that of a scroll wheel is drawn once rather than once for every key. The
+ * screen is drawn at most once every FRAME_MS milliseconds; input that
+ * arrives sooner than that is added to the same frame.
  */
-static int
-init_buffer(Buffer *const b, const char *const path)
+static void
+input_loop(void)
 {
-	FILE *fp;
-	char *errfunc;
-	long i;
+	int c, dirty, buffers, lines;
+	long last, wait;
 
-	/* Spaces are intentionally used for alignment here because this is an
-	 * odd expression and formatting the usual way with tabs looks worse.
-	 */
-	if ( (errfunc = "fopen", (fp = fopen(path, "r")) == NULL) ||
-	     (errfunc = "fseek", fseek(fp, 0L, SEEK_END) == -1)   ||
-	     (errfunc = "ftell", (b->length = ftell(fp)) == -1) ) {
-		ewarn("cannot %s %s", errfunc, path);
-		error_buffer(b, "%s: cannot %s %s: %s\n",
-				argv0, errfunc, path, strerror(errno));
-		return -1;
-	}
+	dirty = buffers = lines = 0;
+	last = clock_ms();
 
-	rewind(fp);
-	b->size = b->length + 1;
-	if ((b->text = malloc(sizeof(*b->text) * b->size)) == NULL)
-		err(EXIT_FAILURE, "malloc failed");
-	if (fread(b->text, sizeof(char), b->length, fp) != (size_t)b->length) {
-		warn("fread failed on %s\n", path);
-		error_buffer(b, "%s: fread failed on %s\n", argv0, path);
-		return -1;
-	}
+	for (;;) {
+		/* Only wait for input if there is nothing to draw. */
+		read_input(dirty ? 0 : -1);
+
+		/* More files have been found. This is checked without being
+		 * woken up, as a prompt may have been woken up for them.
+		 */
+		if (take_files())
+			dirty = 1;
 
-	/* Terminate the string. */
-	b->text[b->length] = '\0';
+		/* More of standard input has been read. */
+		if (take_stream())
+			dirty = 1;
 
-	/* Now we must find the amount of lines, and the location of all of the
-	 * starts of lines. This will be used in scrolling the screen.
-	 */
+		/* The file being followed has been written to. */
+		if (take_follow())
+			dirty = 1;
 
-	b->top = 0;
-	/* Get this edge case out of the way first. */
-	if (b->length == 0) {
-		b->st_amt = 0;
+		if (truncated) {
+			truncated = 0;
+			message = "A file got shorter while it was shown";
+			dirty = 1;
+		}
+
+		/* More results, or the lines of a filter, have come in. */
+		if (woken) {
+			woken = 0;
+			if (results.open || take_filter())
+				dirty = 1;
+		}
+
+		while ((c = take_key()) != EOF) {
+			/* A message is only shown until the next key. */
+			if (message != NULL) {
+				message = NULL;
+				dirty = 1;
+			}
+
+			/* Keep adding to a run of movement of one kind. A
+			 * run is carried out once a key of another kind comes.
+			 */
+			switch (c) {
+			case 'h':
+			case 'l':
+				move(0, lines);
+				lines = 0;
+				/* 'h' moves to the next-most-recent buffer, 'l'
+				 * to the next-less-recent buffer.
+				 */
+				buffers += c == 'l' ? 1 : -1;
+				dirty = 1;
+				continue;
+			case 'j':
+			case 'k':
+			case CTRL_E:
+			case CTRL_Y:
+				move(buffers, 0);
+				buffers = 0;
+				/* Scroll down or up one line. */
+				lines += c == 'j' || c == CTRL_E ? 1 : -1;
+				dirty = 1;
+				continue;
+			}
+
+			move(buffers, lines);
+			buffers = lines = 0;
+
+			if (results.open && results_key(c)) {
+				dirty = 1;
+				continue;
+			}
+
+			switch (c) {
+			case 'g':
+				scroll_to_top();
+				dirty = 1;
+				break;
+			case 'G':
+				scroll_to_bottom();
+				dirty = 1;
+				break;
+			case 'F':
+				/* Follow what is written to the end of the
+				 * current buffer, or stop following it.
+				 */
+				follow_buffer(bufl.v[bufl.n]);
+				take_follow();
+				dirty = 1;
+				break;
+			case 'H':
+				/* Move to the first buffer. */
+				change_buffer(0);
+				dirty = 1;
+				break;
+			case 'L':
+				/* Move to the last buffer. */
+				change_buffer(bufl.amt - 1);
+				dirty = 1;
+				break;
+			case 'n':
+				/* Repeat the last search. */
+				find_next(search.backward);
+				dirty = 1;
+				break;
+			case 'N':
+				/* Repeat the last search, in reverse. */
+				find_next(!search.backward);
+				dirty = 1;
+				break;
+			case '*':
+				/* Show the results of the last search of every
+				 * buffer again.
+				 */
+				search_all("");
+				dirty = 1;
+				break;
+			case '&':
+				/* The prompt is drawn over the status bar, so
+				 * the screen must be up to date first.
+				 */
+				display();
+				start_filter();
+				dirty = 1;
+				break;
+			case '#':
+				toggle_numbers();
+				dirty = 1;
+				break;
+			case 'q':
+				exit(EXIT_SUCCESS);
+				break;
+			case 'r':
+				redraw();
+				dirty = 1;
+				break;
+			case 'i':
+			case '!':
+				/* These draw over the screen themselves, so it
+				 * must be up to date first.
+				 */
+				display();
+				dirty = 0;
+				if (c == 'i')
+					info();
+				else
+					execute_command();
+				last = clock_ms();
+				break;
+			case '/':
+			case '?':
+				/* The prompt is drawn over the status bar, so
+				 * the screen must be up to date first.
+				 */
+				display();
+				start_search(c == '?');
+				dirty = 1;
+				break;
+			}
+		}
+
+		move(buffers, lines);
+		buffers = lines = 0;
+
+		if (!dirty)
+			continue;
+
+		/* Too soon for another frame. Wait for it, adding whatever
+		 * input arrives in the meantime to this frame.
+		 */
+		if ((wait = last + FRAME_MS - clock_ms()) > 0 &&
+				read_input(wait) > 0)
+			continue;
+
+		display();
+		dirty = 0;
+		last = clock_ms();
+	}
+}
+
+/*
+ * Return whether or not lines 'first' through 'last' of b, as indices into
+ * the lines that are shown (see view_line()), are each short enough to be
+ * drawn on one row of the screen, without wrapping onto the next. This errs
+ * on the side of saying a line does not fit, because only the length of the
+ * line in bytes is known, and a tab may take up to eight columns.
+ */
+static int
+lines_fit(const Buffer *const b, const int first, const int last)
+{
+	const char *p, *end;
+	long width;
+	int i, line;
+
+	if (cols <= 0)
 		return 0;
+
+	for (i = first; i <= last && i < view_amt(b); i++) {
+		line = view_line(b, i);
+		p = b->text + lines_start(&b->st, line);
+		end = b->text + lines_end(&b->st, line, b->length);
+
+		/* Leave room for the line number, and don't count the
+		 * newline, which doesn't take up a column.
+		 */
+		width = (end - p) + (flags.numbers ? snprintf(NULL, 0,
+				"%3d ", line + 1) : 0);
+		if (end > p && end[-1] == '\n')
+			width--;
+
+		while ((p = memchr(p, '\t', end - p)) != NULL && ++p <= end)
+			width += 7;
+
+		if (width >= cols)
+			return 0;
 	}
 
-	/* We will increment memory in blocks of 10. That is, every time we
-	 * reallocate memory because there is not enough room, we will add
-	 * enough memory to fit ten more char pointers.
-	 */
-	b->st_size = ST_SIZE_INCR;
-	if ((b->st = malloc(sizeof(*b->st) * b->st_size)) == NULL)
-		err(EXIT_FAILURE, "malloc failed");
+	return 1;
+}
 
-	/* The first line starts at the first character of the text, so we
-	 * start there.
-	 */
-	b->st[0] = b->text;
-	b->st_amt = 1;
+/*
+ * Read the watchlist at path, which has a word on each line, and build the
+ * automaton that finds the words in buffers. See watch_buffer().
+ */
+static void
+load_watchlist(const char *const path)
+{
+	FILE *fp;
+	char **words, *line;
+	size_t size;
+	ssize_t len;
+	int amt, wsize;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		ewarn("cannot open %s", path);
+		return;
+	}
 
-	for (i = 1; i < b->length; i++) {
-		if (b->text[i - 1] != '\n')
+	words = NULL;
+	amt = wsize = 0;
+	line = NULL;
+	size = 0;
+	while ((len = getline(&line, &size, fp)) != -1) {
+		if (len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+		if (len == 0)
 			continue;
 
-		/* b->text[i] is the first character of a line, so append
-		 * &b->text[i] to b->st.
-		 */
-		while (b->st_size <= b->st_amt) {
-			b->st_size += ST_SIZE_INCR;
-			b->st = realloc(b->st, sizeof(*b->st) * b->st_size);
-			if (b->st == NULL)
+		if (amt == wsize) {
+			wsize = wsize == 0 ? 64 : wsize * 2;
+			if ((words = realloc(words, sizeof(*words) * wsize)) ==
+					NULL)
 				err(EXIT_FAILURE, "realloc failed");
 		}
+		if ((words[amt++] = strdup(line)) == NULL)
+			err(EXIT_FAILURE, "strdup failed");
+	}
+	free(line);
+	fclose(fp);
+
+	watching = ac_build(&watchlist, words, amt, flags.icase) == 0;
+
+	while (amt > 0)
+		free(words[--amt]);
+	free(words);
+}
+
+/*
+ * Return the greatest line of b that can be at the top of the screen, which
+ * is the one that puts the last line of b at the bottom of the screen, or 0
+ * if the whole buffer fits on the screen.
+ */
+int
+max_top(const Buffer *const b)
+{
+	return view_amt(b) - rows + 1 > 0 ? view_amt(b) - rows + 1 : 0;
+}
 
-		b->st[b->st_amt++] = &b->text[i];
+/*
+ * Move by 'buffers' buffers, and then scroll by 'lines' lines. Movement past
+ * the first or last buffer, or past the top or bottom of a buffer, goes as far
+ * as it can instead. While the results of a search of every buffer are shown,
+ * lines move the selection instead, and buffers are ignored.
+ */
+static void
+move(const int buffers, const int lines)
+{
+	int new;
+
+	if (results.open) {
+		pthread_mutex_lock(&results.lock);
+		new = results.sel + lines;
+		results.sel = new >= results.amt ? results.amt - 1 : new;
+		if (results.sel < 0)
+			results.sel = 0;
+		pthread_mutex_unlock(&results.lock);
+		return;
 	}
 
-	return 0;
+	if (buffers != 0) {
+		new = bufl.n + buffers;
+		change_buffer(new < 0 ? 0 : new >= bufl.amt ? bufl.amt - 1 : new);
+	}
+
+	if (lines != 0)
+		scroll(lines);
 }
 
 /*
- * The main input loop.
+ * Jump to the selected result of the last search of every buffer, closing
+ * the results. The pattern becomes that of the last search, so that 'n' and
+ * 'N' go on to the next and previous lines with it.
  */
 static void
-input_loop(void)
+open_result(void)
 {
-	for (;;) {
-		switch (getc(tty)) {
-		case 'g':
-			scroll_to_top();
-			break;
-		case 'G':
-			scroll_to_bottom();
-			break;
-		case 'h':
-			/* Move to the next-most-recent buffer. */
-			change_buffer(bufl.n - 1);
-			break;
-		case 'H':
-			/* Move to the first buffer. */
-			change_buffer(0);
-			break;
-		case 'i':
-			info();
-			break;
-		case 'j':
-		case CTRL_E:
-			/* Scroll down one line. */
-			scroll(1);
-			break;
-		case 'k':
-		case CTRL_Y:
-			/* Scroll up one line. */
-			scroll(-1);
-			break;
-		case 'l':
-			/* Move to the next-less-recent buffer. */
-			change_buffer(bufl.n + 1);
-			break;
-		case 'L':
-			/* Move to the last buffer. */
-			change_buffer(bufl.amt - 1);
-			break;
-		case 'N':
-			toggle_numbers();
-			break;
-		case 'q':
-			exit(EXIT_SUCCESS);
-			break;
-		case 'r':
-			redraw();
-			break;
-		case '!':
-			execute_command();
-			break;
+	Buffer *b;
+	Result r;
+
+	pthread_mutex_lock(&results.lock);
+	if (results.amt == 0) {
+		pthread_mutex_unlock(&results.lock);
+		return;
+	}
+	r = results.v[results.sel];
+	pthread_mutex_unlock(&results.lock);
+
+	results.open = 0;
+	change_buffer(r.buffer);
+	b = bufl.v[bufl.n];
+
+	if (search.pattern != NULL)
+		pattern_put(search.pattern);
+	search.pattern = pattern_keep(results.pattern);
+	search.backward = 0;
+	search.buffer = b;
+	search.hit = -1;
+	/* The file may have changed since it was searched. */
+	search.line = r.line < b->st.amt ? r.line : 0;
+	b->top = view_find(b, search.line) < max_top(b) ?
+		view_find(b, search.line) : max_top(b);
+}
+
+/*
+ * Print the warnings held back since defer_warnings(), and print any later
+ * ones at once.
+ *
+ * This function is registered with atexit(3).
+ */
+static void
+print_warnings(void)
+{
+	pthread_mutex_lock(&warnings.lock);
+	warn_hook = NULL;
+	fwrite(warnings.v, 1, warnings.len, stderr);
+	free(warnings.v);
+	warnings.v = NULL;
+	warnings.len = warnings.size = 0;
+	pthread_mutex_unlock(&warnings.lock);
+}
+
+/*
+ * Show the prompt p in the status bar, and return the line that the user
+ * enters in response, or NULL if none is entered. The line must be freed by
+ * the caller.
+ */
+static char *
+prompt(const char *const p)
+{
+	const color_code PROMPT_COLOR = YELLOW;
+	char *line;
+
+	/* Clear the status line before showing the prompt. */
+	gotoxy(1, rows);
+	clear_current_line();
+
+	/* We want to be able to see characters entered in readline. */
+	restore_terminal();
+
+	setColor(PROMPT_COLOR); /* Display readline prompt in PROMPT_COLOR */
+	rl_instream = tty;
+	rl_getc_function = readline_get_key;
+	line = readline(p);
+	resetColor();
+	fflush(stdout);
+
+	update_terminal();
+
+	/* readline drew over the status bar. */
+	frame_invalidate(&frame);
+
+	return line;
+}
+
+/*
+ * Add at most 'width' of the 'len' bytes at s to the frame, without cutting a
+ * UTF-8 character in two, and return how many were added. No character takes
+ * up more columns than it has bytes, so what is added fits in 'width'
+ * columns.
+ */
+static long
+put_fitted(const char *const s, const long len, const long width)
+{
+	long n;
+
+	if (width <= 0)
+		return 0;
+
+	n = len;
+	if (n > width) {
+		n = width;
+		while (n > 0 && (s[n] & 0xc0) == 0x80)
+			n--;
+	}
+
+	frame_put(&frame, s, n);
+
+	return n;
+}
+
+/*
+ * Wait up to 'timeout' milliseconds, or forever if timeout is negative, for
+ * input from the terminal, for wake_up(), or for the file being followed to be
+ * written to, and then add all of the input that is waiting to be read to the
+ * input queue. Returns the amount of keys added; woken is set if wake_up() was
+ * called, and follow.changed if the file was written to. If the terminal
+ * cannot be read from anymore, the program shall be exited with code
+ * EXIT_FAILURE.
+ */
+static int
+read_input(const int timeout)
+{
+	struct pollfd pfd[3];
+	char drain[64];
+	ssize_t n;
+
+	/* poll(2) passes over a negative fd, which follow.notify is until
+	 * something is followed.
+	 */
+	pfd[0].fd = ttyno;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = wakefd[0];
+	pfd[1].events = POLLIN;
+	pfd[2].fd = follow.notify;
+	pfd[2].events = POLLIN;
+	if (poll(pfd, 3, timeout) <= 0)
+		return 0;
+
+	if (pfd[1].revents != 0) {
+		while (read(wakefd[0], drain, sizeof(drain)) > 0)
+			;
+		woken = 1;
+	}
+	if (pfd[2].revents != 0)
+		read_follow();
+	if (pfd[0].revents == 0)
+		return 0;
+
+	/* Move the keys left to be handled to the start of the queue, to make
+	 * as much room for new ones as there can be.
+	 */
+	memmove(input.v, input.v + input.head, input.amt);
+	input.head = 0;
+
+	n = read(ttyno, input.v + input.amt, INPUT_SIZE - input.amt);
+	if (n == 0 || (n == -1 && errno != EINTR && errno != EAGAIN))
+		err(EXIT_FAILURE, "cannot read /dev/tty");
+	if (n == -1)
+		return 0;
+
+	input.amt += n;
+
+	return n;
+}
+
+/*
+ * Wrapper around get_key() with the signature of rl_getc_function, so that
+ * readline reads keys that are already in the input queue first. While a
+ * filter is being typed, the lines of it are shown as well.
+ */
+static int
+readline_get_key(FILE *stream)
+{
+	int c;
+
+	(void)stream;
+
+	if (filtering == NULL)
+		return get_key();
+
+	/* Filter for what has been typed so far, and show the lines of the
+	 * filter as they are found while waiting for the next key.
+	 */
+	filter_buffer(filtering, rl_line_buffer);
+	while ((c = take_key()) == EOF) {
+		read_input(-1);
+		if (woken) {
+			woken = 0;
+			if (take_filter())
+				display_filtering();
 		}
 	}
+
+	return c;
 }
 
 /*
- * Redraw the current buffer.
+ * Redraw the current buffer. What was on the screen is forgotten, so that the
+ * whole screen is drawn by the next frame of input_loop().
  */
 static void
 redraw(void)
 {
-	update_rows();
-	display_buffer(&bufl.v[bufl.n]);
+	update_size();
 }
 
 /* Restores the terminal to the state it was before
@@ -671,28 +1684,69 @@ restore_terminal(void)
 	showcursor();
 }
 
+/*
+ * Handle the key c while the results of a search of every buffer are shown.
+ * Returns nonzero if c was handled, or zero if it is to be handled as usual.
+ * Keys that would move around the current buffer do nothing here.
+ */
+static int
+results_key(const int c)
+{
+	switch (c) {
+	case 'g':
+		results.sel = 0;
+		break;
+	case 'G':
+		pthread_mutex_lock(&results.lock);
+		results.sel = results.amt > 0 ? results.amt - 1 : 0;
+		pthread_mutex_unlock(&results.lock);
+		break;
+	case ENTER:
+		open_result();
+		break;
+	case 'q':
+		/* Go back to the current buffer. */
+		results.open = 0;
+		break;
+	case 'H':
+	case 'L':
+	case 'n':
+	case 'N':
+		break;
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
 /*
  * Scroll by 'offset' lines in the buffer. On success, 0 is returned;
- * otherwise the line number that would have been made the top of the screen
- * is returned.
+ * otherwise the buffer is scrolled as far as it can go, and the line number
+ * that would have been made the top of the screen is returned.
  */
 static int
 scroll(const int offset)
 {
+	Buffer *const b = bufl.v[bufl.n];
 	int newtop;
 
-	newtop = bufl.v[bufl.n].top + offset;
+	newtop = b->top + offset;
 
-	/* newtop must be >= 0 because it will be used as an array index.
-	 * newtop must be < bufl.v[bufl.n].st_amt - rows + 2 because if it
-	 * isn't, then we will have a buffer overrun of bufl.v[bufl.n].st. See
-	 * display_buffer() for a better understanding of this.
+	/* The top must be >= 0 because it will be used as an array index.
+	 * The top must be < view_amt(b) - rows + 2 because if it isn't, then
+	 * we will have a buffer overrun of b->st. See display_lines() for a
+	 * better understanding of this.
 	 */
-	if (newtop < 0 || newtop >= bufl.v[bufl.n].st_amt - rows + 2)
+	if (newtop < 0 || newtop >= view_amt(b) - rows + 2) {
+		if (offset > 0)
+			scroll_to_bottom();
+		else
+			scroll_to_top();
 		return newtop;
+	}
 
-	bufl.v[bufl.n].top = newtop;
-	display_buffer(&bufl.v[bufl.n]);
+	b->top = newtop;
 	return 0;
 }
 
@@ -702,18 +1756,96 @@ scroll(const int offset)
 static void
 scroll_to_top(void)
 {
-	bufl.v[bufl.n].top = 0;
-	display_buffer(&bufl.v[bufl.n]);
+	bufl.v[bufl.n]->top = 0;
 }
 
 /*
- * Scroll to the bottom of the buffer.
+ * Scroll to the bottom of the buffer, or to the top if the whole buffer fits
+ * on the screen.
  */
 static void
 scroll_to_bottom(void)
 {
-	bufl.v[bufl.n].top = bufl.v[bufl.n].st_amt - rows + 1;
-	display_buffer(&bufl.v[bufl.n]);
+	bufl.v[bufl.n]->top = max_top(bufl.v[bufl.n]);
+}
+
+/*
+ * Prompt for a pattern, and show only the lines of the current buffer that
+ * have it. The lines shown change as the pattern is typed. If no pattern is
+ * entered, every line is shown again.
+ */
+static void
+start_filter(void)
+{
+	char *line;
+
+	filtering = bufl.v[bufl.n];
+	line = prompt("&");
+	filtering = NULL;
+
+	if (line == NULL)
+		return;
+
+	/* Only say what is wrong with the pattern as it was entered. */
+	message = NULL;
+	filter_buffer(bufl.v[bufl.n], line);
+	free(line);
+}
+
+/*
+ * Prompt for a pattern, and find the next line with it in the current buffer
+ * with find_next(). If backward is nonzero, the search is backward. If no
+ * pattern is entered, the last one is searched for again, in the new
+ * direction. A pattern that starts with '*' is searched for in every buffer
+ * instead, with search_all().
+ */
+static void
+start_search(const int backward)
+{
+	Pattern *p;
+	char *line;
+
+	if ((line = prompt(backward ? "?" : "/")) == NULL)
+		return;
+
+	if (line[0] == '*') {
+		search_all(line + 1);
+		free(line);
+		return;
+	}
+
+	/* The search is of the current buffer. */
+	results.open = 0;
+
+	if (line[0] != '\0') {
+		p = compile_pattern(line);
+		free(line);
+		if (p == NULL)
+			return;
+		if (search.pattern != NULL)
+			pattern_put(search.pattern);
+		search.pattern = p;
+		search.buffer = NULL;
+	} else {
+		free(line);
+	}
+
+	search.backward = backward;
+	find_next(backward);
+}
+
+/*
+ * Take the next key from the input queue without waiting. Returns EOF if
+ * there are none.
+ */
+static int
+take_key(void)
+{
+	if (input.amt == 0)
+		return EOF;
+
+	input.amt--;
+	return input.v[input.head++];
 }
 
 /*
@@ -723,30 +1855,35 @@ static void
 toggle_numbers(void)
 {
 	flags.numbers = !flags.numbers;
-	display_buffer(&bufl.v[bufl.n]);
 }
 
 /*
- * Update the 'rows' global variable.
- * This code is mostly copied from the rogueutil function trows(), but using
- * ttyno instead of STDIN_FILENO, and without a _WIN32 preprocessor block.
+ * Update the 'rows' and 'cols' global variables, and the size of the frame.
+ * This code is mostly copied from the rogueutil functions trows() and tcols(),
+ * but using ttyno instead of STDIN_FILENO, and without a _WIN32 preprocessor
+ * block.
  */
 static void
-update_rows(void)
+update_size(void)
 {
 #ifdef TIOCGSIZE
 	struct ttysize ts;
 
 	ioctl(ttyno, TIOCGSIZE, &ts);
 	rows = ts.ts_lines;
+	cols = ts.ts_cols;
 #elif defined(TIOCGWINSZ)
 	struct winsize ts;
 
 	ioctl(ttyno, TIOCGWINSZ, &ts);
 	rows = ts.ws_row;
+	cols = ts.ws_col;
 #else /* TIOCGSIZE */
 	rows = -1;
+	cols = -1;
 #endif /* TIOCGSIZE */
+
+	frame_resize(&frame, rows);
 }
 
 /*
@@ -782,11 +1919,80 @@ version(void)
 	puts("navipage " VERSION);
 }
 
+/*
+ * Return how many lines of b are shown: all of them, unless it is filtered.
+ */
+int
+view_amt(const Buffer *const b)
+{
+	return b->filter.pattern != NULL ? b->filter.amt : b->st.amt;
+}
+
+/*
+ * Return the index of the first line shown of b that is 'line' or after it,
+ * or view_amt(b) if there is none.
+ */
+int
+view_find(const Buffer *const b, const int line)
+{
+	int lo, hi, mid;
+
+	if (b->filter.pattern == NULL)
+		return line < b->st.amt ? line : b->st.amt;
+
+	lo = 0;
+	hi = b->filter.amt;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (b->filter.v[mid] < line)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * Return the line of b that is the 'i'-th one shown. Unless b is filtered,
+ * that is line i.
+ */
+int
+view_line(const Buffer *const b, const int i)
+{
+	return b->filter.pattern != NULL ? b->filter.v[i] : i;
+}
+
+/*
+ * Wake the main thread up from read_input(), so that it draws the screen
+ * again. This is called by worker threads.
+ */
+void
+wake_up(void)
+{
+	/* If the pipe is full, the main thread has yet to be woken up anyway. */
+	while (write(wakefd[1], "", 1) == -1 && errno == EINTR)
+		;
+}
+
+/*
+ * Find the words of the watchlist in b, in a single pass over its text.
+ */
+void
+watch_buffer(Buffer *const b)
+{
+	if (watching)
+		b->watched.hits = ac_find(&watchlist, b->text, b->length,
+				&b->watched.v, &b->watched.amt);
+}
+
 int
 main(int argc, char *argv[])
 {
-	int c, i;
+	int c, i, piped;
 	char *envstr;
+	pthread_t thread;
+	struct stat statbuf;
 	struct sigaction sa = {0};
 
 	argv0 = argv[0];
@@ -812,18 +2018,42 @@ main(int argc, char *argv[])
 
 	update_terminal();
 
+	/* Warnings held back while the screen was drawn on are printed after
+	 * the terminal is restored, which is registered after this.
+	 */
+	atexit(print_warnings);
 	atexit(restore_terminal);
 
+	/* A mapped file that gets shorter while it is being read raises
+	 * SIGBUS. See handle_bus().
+	 */
+	pagesize = sysconf(_SC_PAGESIZE);
+	zerofd = open("/dev/zero", O_RDONLY);
+	sa.sa_handler = NULL;
+	sa.sa_sigaction = handle_bus;
+	sa.sa_flags = SA_SIGINFO;
+	if (sigaction(SIGBUS, &sa, NULL) == -1)
+		err(EXIT_FAILURE, "cannot sigaction");
+
 	/* Handle options. */
-	while ((c = getopt(argc, argv, "dhnrsv")) != -1) {
+	while ((c = getopt(argc, argv, "adEhinrsv")) != -1) {
 		switch (c) {
+		case 'a':
+			flags.all = 1;
+			break;
 		case 'd':
 			flags.debug = 1;
 			break;
+		case 'E':
+			flags.regex = 1;
+			break;
 		case 'h':
 			usage();
 			exit(EXIT_SUCCESS);
 			break;
+		case 'i':
+			flags.icase = 1;
+			break;
 		case 'n':
 			flags.numbers = 1;
 			break;
@@ -855,47 +2085,85 @@ main(int argc, char *argv[])
 	if (flags.sh && (envstr = getenv("NAVIPAGE_SH")) != NULL)
 		system(envstr);
 
-	/*
-	 * Add paths to filel.
+	loader.pool = pool_create(0);
+
+	/* Highlight the words of $NAVIPAGE_WATCHLIST. This must be done
+	 * before any buffer is read.
 	 */
+	if ((envstr = getenv("NAVIPAGE_WATCHLIST")) != NULL &&
+			envstr[0] != '\0')
+		load_watchlist(envstr);
 
-	filel.used = 0;
-	if (filel.size = sizeof(*filel.v) * FILEL_SIZE_INCR,
-			(filel.v = malloc(filel.size)) == NULL)
-		err(EXIT_FAILURE, "malloc failed");
+	if ((loader.cache = cache_path("lines")) != NULL)
+		mkdir(loader.cache, 0700);
 
-	/* Add the files at $NAVIPAGE_DIR to filel. */
-	if (argc == 0 && (envstr = getenv("NAVIPAGE_DIR")) != NULL)
-		add_path(envstr, RECURSE);
+	/* Worker threads write to this pipe to wake up the main thread. Neither
+	 * end may block: the main thread drains it, and worker threads do not
+	 * wait on it.
+	 */
+	if (pipe(wakefd) == -1)
+		err(EXIT_FAILURE, "cannot pipe");
+	for (i = 0; i < 2; i++)
+		if (fcntl(wakefd[i], F_SETFL, O_NONBLOCK) == -1)
+			err(EXIT_FAILURE, "cannot fcntl");
 
-	/* All remaining arguments are paths to files to be read. */
-	for (i = 0; i < argc; i++)
-		add_path(argv[i], flags.recurse_more);
+	/*
+	 * Find the files to be read: those at $NAVIPAGE_DIR, and those at the
+	 * remaining arguments. They are found in the background, and become
+	 * buffers as they are; the first is shown as soon as it is found.
+	 * Unless -a was given, a buffer is only read once it is needed, or
+	 * ahead of time by the loader's worker threads.
+	 */
+	defer_warnings();
+	piped = fstat(STDIN_FILENO, &statbuf) == 0 &&
+			(S_ISFIFO(statbuf.st_mode) ||
+			 S_ISREG(statbuf.st_mode) ||
+			 S_ISSOCK(statbuf.st_mode));
+	if (argc == 1 && strcmp(argv[0], "-") == 0 && !piped) {
+		warn("cannot read standard input: not a pipe or file\n");
+		exit(EXIT_FAILURE);
+	}
+	if ((argc == 1 && strcmp(argv[0], "-") == 0) || (argc == 0 &&
+			getenv("NAVIPAGE_DIR") == NULL && piped)) {
+		/* Show what is piped or redirected to the program instead,
+		 * when it is asked for with "-", or when there is nothing else
+		 * to show. Otherwise, scripts and cron jobs that happen to
+		 * have a pipe or file on standard input would not be shown
+		 * $NAVIPAGE_DIR.
+		 */
+		read_stdin(&statbuf);
+		discovery.settled = 1;
+	} else {
+		if (argc == 0 && (envstr = getenv("NAVIPAGE_DIR")) != NULL) {
+			discovery.dir = envstr;
+			indexed = 1;
+		}
+		discovery.paths = argv;
+		discovery.amt = argc;
+		discovery.pool = pool_create(0);
+		if (pthread_create(&thread, NULL, discover, NULL) != 0)
+			err(EXIT_FAILURE, "cannot pthread_create");
+		pthread_detach(thread);
+	}
+
+	while (bufl.amt == 0 && !discovery.settled) {
+		read_input(-1);
+		woken = 0;
+		take_files();
+	}
 
 	/* Exit the program if no files were read. */
-	if (filel.amt == 0) {
+	if (bufl.amt == 0) {
 		if (argc == 0)
 			usage();
 		exit(EXIT_FAILURE);
 	}
 
-	qsort(filel.v, filel.amt, sizeof(*filel.v), compare_path_basenames);
-
-	/*
-	 * Iniitalize buffers.
-	 */
-	bufl.amt = filel.amt;
-	bufl.n = 0;
-	if ((bufl.v = malloc(sizeof(*bufl.v) * bufl.amt)) == NULL)
-		err(EXIT_FAILURE, "malloc failed");
-	for (i = 0; i < bufl.amt; i++)
-		init_buffer(&bufl.v[i], filel.v[i]);
-
 	atexit(cleanup_display);
 
-	update_rows();
+	update_size();
 	cls();
-	display_buffer(&bufl.v[bufl.n]);
+	display_buffer(bufl.v[bufl.n]);
 
 	input_loop(); /* Doesn't return, but just in case... */
 
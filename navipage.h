@@ -0,0 +1,213 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef NAVIPAGE_H
+#define NAVIPAGE_H
+
+/*
+ * What is shared between main.c and the parts of navipage that are kept in
+ * files of their own: buffers, and the state and functions of main.c that
+ * those parts use.
+ */
+
+#include "ac.h"
+#include "filekey.h"
+#include "lines.h"
+#include "pattern.h"
+
+/*
+ * Whether or not a buffer has been read from its file yet. Buffers are read
+ * only once they are needed; see load_buffer().
+ */
+enum buffer_state {
+	UNLOADED = 0,
+	LOADING,
+	LOADED
+};
+
+/*
+ * The lines of a buffer that have a pattern. These are found all at once the
+ * first time that the buffer is searched for the pattern, and kept until it
+ * is searched for another one, so that stepping from one line to the next
+ * does not search the text again. See find_matches().
+ */
+typedef struct {
+	/* The pattern, or NULL if the buffer has not been searched. */
+	Pattern *pattern;
+
+	/* The lines with the pattern, in order. */
+	int *v;
+	int amt;
+
+	/* One bit for every line of the buffer, set if it has the pattern. */
+	unsigned char *bits;
+} Matches;
+
+/*
+ * The lines of a buffer that are shown while it is filtered with '&'. While a
+ * buffer is filtered, its top, and the lines of the screen, are indices into
+ * v rather than into its lines. See view_line().
+ */
+typedef struct {
+	/* The pattern, or NULL if the buffer is not filtered. */
+	Pattern *pattern;
+
+	/* The lines with the pattern, in order. */
+	int *v;
+	int amt;
+} Filter;
+
+/*
+ * The words of the watchlist that are in a buffer. See watch_buffer().
+ */
+typedef struct {
+	/* The spans of text that they cover, in order. */
+	Span *v;
+	long amt;
+
+	/* How many times they are in the buffer in all. */
+	long hits;
+} Watched;
+
+/*
+ * A file buffer. This contains the actual text of the file, but also
+ * pointers to the line breaks of the file, which come into use when the file
+ * is being scrolled through.
+ */
+typedef struct {
+	/* Whether text, st, etc. have been initialized yet. Guarded by
+	 * loader.lock.
+	 */
+	enum buffer_state state;
+
+	/* The path of the file, and what it is sorted by. */
+	FileKey key;
+
+	/* The actual text of the file. This is not terminated by a null
+	 * character, because it may be mapped directly from the file.
+	 */
+	char *text;
+
+	/* The length of the file. */
+	long length;
+
+	/* The amount of space allocated for the file, if it was read into
+	 * memory rather than mapped.
+	 */
+	long size;
+
+	/* Whether text is a read-only mapping of the file. See map_buffer(). */
+	int mapped;
+
+	/* Where every line of the text starts. This is used in scrolling. */
+	LineIndex st;
+
+	/* The index of the line that is drawn at the top of the screen. See
+	 * scroll().
+	 */
+	int top;
+
+	/* The lines that have the pattern of the last search. */
+	Matches matches;
+
+	/* The lines that are shown, if the buffer is filtered. */
+	Filter filter;
+
+	/* Where the words of the watchlist are. */
+	Watched watched;
+} Buffer;
+
+/*
+ * A list of file buffers. Buffers can be switched between during the run of
+ * the program.
+ */
+typedef struct {
+	/* The amount of buffers in the list. */
+	int amt;
+
+	/* Index of the buffer that is currently open to the user. */
+	int n;
+
+	/* Whether the user has moved to another buffer. Until then, the first
+	 * buffer, which is the newest file found so far, is kept open while
+	 * files are still being found. See take_files().
+	 */
+	int moved;
+
+	/* Pointer to the array, and the amount of buffers that there is space
+	 * allocated for in it. Buffers are allocated one by one, so that they
+	 * stay where they are as buffers are inserted before them.
+	 */
+	Buffer **v;
+	int size;
+} BufferList;
+
+/*
+ * A list of files that will be read into buffers. They are not read into
+ * buffers immediately because not all will be necessary.
+ */
+typedef struct {
+	/* The amount of files in the list. */
+	int amt;
+
+	/* The amount of paths that there is space allocated for in the
+	 * array.
+	 */
+	int size;
+
+	/* Pointer to the array. */
+	char **v;
+
+	/* The paths themselves are packed one after another into blocks,
+	 * which are never moved or freed, so that the array can point into
+	 * them while it grows; this takes one allocation for every few
+	 * thousand paths. block is where the next path goes in the newest
+	 * block, and left is how much room there is left in it.
+	 */
+	char *block;
+	size_t left;
+} FileList;
+
+typedef struct {
+	unsigned int all:1;
+	unsigned int debug:1;
+	unsigned int regex:1;
+	unsigned int icase:1;
+	unsigned int numbers:1;
+	unsigned int recurse_more:1;
+	unsigned int sh:1;
+} Flags;
+
+extern BufferList bufl;
+extern FileList filel;
+extern Flags flags;
+extern int indexed;
+extern const char *message;
+
+char *cache_path(const char *const);
+Pattern *compile_pattern(const char *const);
+void forget_highlights(const Buffer *const);
+void grow_buffer(Buffer *const, const long);
+int max_top(const Buffer *const);
+int view_amt(const Buffer *const);
+int view_find(const Buffer *const, const int);
+int view_line(const Buffer *const, const int);
+void wake_up(void);
+void watch_buffer(Buffer *const);
+
+#endif /* NAVIPAGE_H */
@@ -0,0 +1,252 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <pthread.h>
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "err.h"
+#include "pattern.h"
+#include "search.h"
+
+/* How many of the most recently gotten patterns are kept compiled after they
+ * are put back.
+ */
+#define PATTERN_CACHE 8
+
+struct Pattern {
+	/* The pattern as it was given, and its length. */
+	char *source;
+	long len;
+
+	/* The flags it was gotten with. */
+	int flags;
+
+	/* The compiled regex, if the pattern is one. */
+	regex_t re;
+
+	/* How many users the pattern has, counting the cache as one. */
+	int refs;
+};
+
+/*
+ * The most recently gotten patterns, most recent first.
+ */
+static struct {
+	pthread_mutex_t lock;
+	Pattern *v[PATTERN_CACHE];
+	int amt;
+} cache = { PTHREAD_MUTEX_INITIALIZER, { NULL }, 0 };
+
+static void release(Pattern *const);
+
+/*
+ * Drop a reference to p, freeing it if it was the last. cache.lock must be
+ * held.
+ */
+static void
+release(Pattern *const p)
+{
+	if (--p->refs > 0)
+		return;
+
+	if (p->flags & PATTERN_REGEX)
+		regfree(&p->re);
+	free(p->source);
+	free(p);
+}
+
+/*
+ * Return whether every line with p is known to have q as well, which is when
+ * both are literal, with the same flags, and p has q in it.
+ */
+int
+pattern_contains(const Pattern *const p, const Pattern *const q)
+{
+	return !(p->flags & PATTERN_REGEX) && p->flags == q->flags &&
+		strstr(p->source, q->source) != NULL;
+}
+
+/*
+ * Return the flags that p was gotten with.
+ */
+int
+pattern_flags(const Pattern *const p)
+{
+	return p->flags;
+}
+
+/*
+ * Return the pattern source with flags, compiling it if it is a regex and was
+ * not already cached. It must be given back with pattern_put(). If the regex
+ * cannot be compiled, NULL is returned and why is written to the 'size'
+ * bytes at error.
+ */
+Pattern *
+pattern_get(const char *const source, const int flags, char *const error,
+		const size_t size)
+{
+	Pattern *p;
+	int i, e;
+
+	pthread_mutex_lock(&cache.lock);
+
+	for (i = 0; i < cache.amt; i++) {
+		p = cache.v[i];
+		if (p->flags == flags && strcmp(p->source, source) == 0) {
+			/* Move it to the front. */
+			memmove(cache.v + 1, cache.v, sizeof(*cache.v) * i);
+			cache.v[0] = p;
+			p->refs++;
+			pthread_mutex_unlock(&cache.lock);
+			return p;
+		}
+	}
+
+	pthread_mutex_unlock(&cache.lock);
+
+	/* Compile outside of the lock, as a regex can take a while. */
+	if ((p = malloc(sizeof(*p))) == NULL ||
+			(p->source = strdup(source)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	p->len = strlen(source);
+	p->flags = flags;
+	p->refs = 2;
+
+	if (flags & PATTERN_REGEX) {
+		/* REG_NEWLINE keeps a match within one line, as with a
+		 * literal pattern.
+		 */
+		e = regcomp(&p->re, source, REG_EXTENDED | REG_NEWLINE |
+				(flags & PATTERN_ICASE ? REG_ICASE : 0));
+		if (e != 0) {
+			regerror(e, &p->re, error, size);
+			free(p->source);
+			free(p);
+			return NULL;
+		}
+	}
+
+	pthread_mutex_lock(&cache.lock);
+	if (cache.amt == PATTERN_CACHE)
+		release(cache.v[--cache.amt]);
+	memmove(cache.v + 1, cache.v, sizeof(*cache.v) * cache.amt);
+	cache.v[0] = p;
+	cache.amt++;
+	pthread_mutex_unlock(&cache.lock);
+
+	return p;
+}
+
+/*
+ * Take another reference to p, which must be given back with pattern_put()
+ * as well. Returns p.
+ */
+Pattern *
+pattern_keep(Pattern *const p)
+{
+	pthread_mutex_lock(&cache.lock);
+	p->refs++;
+	pthread_mutex_unlock(&cache.lock);
+
+	return p;
+}
+
+/*
+ * Find the first match of p in the 'length' characters at text that starts
+ * at or after offset 'start'. Returns the offset of the match and sets *end
+ * to the offset just past it, or returns -1 if there is none. The text before
+ * start is only looked at to tell whether start is at the start of a line.
+ */
+long
+pattern_next(const Pattern *const p, const char *const text,
+		const long start, const long length, long *const end)
+{
+	regmatch_t m;
+	long off;
+	int eflags;
+#ifndef REG_STARTEND
+	const char *nl;
+	char *line;
+	long lstart, lend;
+#endif
+
+	if (start >= length)
+		return -1;
+
+	if (!(p->flags & PATTERN_REGEX)) {
+		off = search_forward(text + start, length - start, p->source,
+				p->len, p->flags & PATTERN_ICASE);
+		if (off == -1)
+			return -1;
+		*end = start + off + p->len;
+		return start + off;
+	}
+
+	eflags = start > 0 && text[start - 1] != '\n' ? REG_NOTBOL : 0;
+
+#ifdef REG_STARTEND
+	/* The text is not null-terminated, so the end of it is given. */
+	m.rm_so = start;
+	m.rm_eo = length;
+	if (regexec(&p->re, text, 1, &m, eflags | REG_STARTEND) != 0)
+		return -1;
+	*end = m.rm_eo;
+	return m.rm_so;
+#else
+	/* Without REG_STARTEND, regexec(3) needs a null-terminated string, so
+	 * each line is copied into one.
+	 */
+	for (lstart = start; lstart < length; lstart = lend + 1, eflags = 0) {
+		nl = memchr(text + lstart, '\n', length - lstart);
+		lend = nl == NULL ? length : nl - text;
+		if ((line = malloc(lend - lstart + 1)) == NULL)
+			err(EXIT_FAILURE, "malloc failed");
+		memcpy(line, text + lstart, lend - lstart);
+		line[lend - lstart] = '\0';
+		if (regexec(&p->re, line, 1, &m, eflags) == 0) {
+			free(line);
+			*end = lstart + m.rm_eo;
+			return lstart + m.rm_so;
+		}
+		free(line);
+	}
+	return -1;
+#endif /* REG_STARTEND */
+}
+
+/*
+ * Give back a pattern gotten with pattern_get().
+ */
+void
+pattern_put(Pattern *const p)
+{
+	pthread_mutex_lock(&cache.lock);
+	release(p);
+	pthread_mutex_unlock(&cache.lock);
+}
+
+/*
+ * Return the pattern as it was given to pattern_get().
+ */
+const char *
+pattern_source(const Pattern *const p)
+{
+	return p->source;
+}
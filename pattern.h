@@ -0,0 +1,45 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stddef.h>
+
+/* Flags of pattern_get(). */
+enum {
+	PATTERN_ICASE = 1, /* Ignore the case of ASCII letters. */
+	PATTERN_REGEX = 2  /* The pattern is a POSIX extended regex. */
+};
+
+/*
+ * A pattern, compiled if it is a regex. Patterns are shared: getting the same
+ * pattern twice gives the same Pattern, for as long as it is cached or in use.
+ */
+typedef struct Pattern Pattern;
+
+int pattern_contains(const Pattern *const, const Pattern *const);
+int pattern_flags(const Pattern *const);
+Pattern *pattern_get(const char *const, const int, char *const, const size_t);
+Pattern *pattern_keep(Pattern *const);
+long pattern_next(const Pattern *const, const char *const, const long,
+		const long, long *const);
+void pattern_put(Pattern *const);
+const char *pattern_source(const Pattern *const);
+
+#endif /* PATTERN_H */
@@ -0,0 +1,156 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "pool.h"
+
+/* How many jobs the queue has room for before it is first grown. */
+#define QUEUE_SIZE_INIT 16
+
+typedef struct {
+	/* The function to call, and the argument to call it with. */
+	void (*fn)(void *);
+	void *arg;
+} Job;
+
+struct Pool {
+	/* Guards the queue. */
+	pthread_mutex_t lock;
+
+	/* Signalled when a job is added to the queue. */
+	pthread_cond_t cond;
+
+	/* A ring buffer of jobs waiting to be run. The oldest job is at
+	 * v[head], and there are amt jobs in total.
+	 */
+	Job *v;
+	int head;
+	int amt;
+
+	/* The amount of space allocated for v. */
+	int size;
+};
+
+/*
+ * The body of every worker thread. Runs jobs from the queue of the pool at
+ * arg, forever.
+ */
+static void *
+work(void *arg)
+{
+	Pool *const p = arg;
+	Job job;
+
+	pthread_mutex_lock(&p->lock);
+	for (;;) {
+		while (p->amt == 0)
+			pthread_cond_wait(&p->cond, &p->lock);
+
+		job = p->v[p->head];
+		p->head = (p->head + 1) % p->size;
+		p->amt--;
+
+		pthread_mutex_unlock(&p->lock);
+		job.fn(job.arg);
+		pthread_mutex_lock(&p->lock);
+	}
+
+	return NULL;
+}
+
+/*
+ * Return the amount of processor cores that are online, or 1 if that cannot
+ * be determined.
+ */
+int
+pool_cores(void)
+{
+	long n;
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n < 1 ? 1 : n;
+}
+
+/*
+ * Start a pool of 'n' worker threads, or of one thread for every core if n
+ * is not positive. Upon irreconciliable errors, such as running out of
+ * memory, the program shall be exited with code EXIT_FAILURE.
+ */
+Pool *
+pool_create(const int n)
+{
+	Pool *p;
+	pthread_t thread;
+	int i;
+
+	if ((p = calloc(1, sizeof(*p))) == NULL)
+		err(EXIT_FAILURE, "calloc failed");
+
+	if ((errno = pthread_mutex_init(&p->lock, NULL)) != 0 ||
+			(errno = pthread_cond_init(&p->cond, NULL)) != 0)
+		err(EXIT_FAILURE, "cannot initialize pool");
+
+	for (i = 0; i < (n > 0 ? n : pool_cores()); i++) {
+		if ((errno = pthread_create(&thread, NULL, work, p)) != 0)
+			err(EXIT_FAILURE, "cannot pthread_create");
+		pthread_detach(thread);
+	}
+
+	return p;
+}
+
+/*
+ * Queue fn to be called with arg on one of the threads of p. Upon
+ * irreconciliable errors, such as running out of memory, the program shall be
+ * exited with code EXIT_FAILURE.
+ */
+void
+pool_submit(Pool *const p, void (*fn)(void *), void *arg)
+{
+	Job *v;
+	int i;
+
+	pthread_mutex_lock(&p->lock);
+
+	/* Double the space whenever it runs out, unwrapping the ring buffer
+	 * into the start of the new allocation.
+	 */
+	if (p->amt == p->size) {
+		p->size = p->size == 0 ? QUEUE_SIZE_INIT : p->size * 2;
+		if ((v = malloc(sizeof(*v) * p->size)) == NULL)
+			err(EXIT_FAILURE, "malloc failed");
+		for (i = 0; i < p->amt; i++)
+			v[i] = p->v[(p->head + i) % p->amt];
+		free(p->v);
+		p->v = v;
+		p->head = 0;
+	}
+
+	p->v[(p->head + p->amt) % p->size].fn = fn;
+	p->v[(p->head + p->amt) % p->size].arg = arg;
+	p->amt++;
+
+	pthread_cond_signal(&p->cond);
+	pthread_mutex_unlock(&p->lock);
+}
@@ -0,0 +1,31 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * A pool of worker threads that run jobs in the order they are submitted.
+ */
+typedef struct Pool Pool;
+
+int pool_cores(void);
+Pool *pool_create(const int);
+void pool_submit(Pool *const, void (*)(void *), void *);
+
+#endif /* POOL_H */
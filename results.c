@@ -0,0 +1,401 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "discovery.h"
+#include "err.h"
+#include "loader.h"
+#include "navipage.h"
+#include "pattern.h"
+#include "pool.h"
+#include "results.h"
+#include "trigram.h"
+
+/* How many characters of a line are kept for the results of a search of
+ * every buffer. See search_text().
+ */
+#define SNIPPET_MAX 256
+
+/*
+ * A job that searches one file for search_all(). Each job has its own copy of
+ * the pattern, so that a new search does not pull it out from under the jobs
+ * of the last one.
+ */
+typedef struct {
+	/* The search that the job is a part of. See Results. */
+	unsigned long gen;
+
+	/* Index of the buffer of the file to search. */
+	int buffer;
+
+	/* The pattern. The job holds a reference to it. */
+	Pattern *pattern;
+
+	/* If the trigram index says that the file does not have the pattern,
+	 * the index of the file in it; otherwise -1. See search_file_job().
+	 */
+	const TrigramIndex *index;
+	int skip;
+} SearchJob;
+
+static void add_results(const SearchJob *const, Result *const, const int);
+static void search_file_job(void *);
+static void search_text(const SearchJob *const, const char *const,
+		const long);
+
+Results results = {
+	PTHREAD_MUTEX_INITIALIZER,
+	NULL, 0, 0, 0, 0, 0, NULL, 0, 0, 0, NULL, NULL, NULL
+};
+
+/*
+ * Add the 'amt' results in v, which were found by the job j, to results, in
+ * the order of their buffers; or free them, if j is part of an older search.
+ * v itself is freed either way.
+ */
+static void
+add_results(const SearchJob *const j, Result *const v, const int amt)
+{
+	int lo, hi, mid, i;
+
+	pthread_mutex_lock(&results.lock);
+
+	if (j->gen != results.gen) {
+		pthread_mutex_unlock(&results.lock);
+		for (i = 0; i < amt; i++)
+			free(v[i].text);
+		free(v);
+		return;
+	}
+
+	results.done++;
+
+	if (amt > 0) {
+		/* The results go after those of every buffer before j's. */
+		lo = 0;
+		hi = results.amt;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (results.v[mid].buffer < j->buffer)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		if (results.amt + amt > results.size) {
+			while (results.amt + amt > results.size)
+				results.size = results.size == 0 ?
+					64 : results.size * 2;
+			results.v = realloc(results.v,
+					sizeof(*results.v) * results.size);
+			if (results.v == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+
+		memmove(results.v + lo + amt, results.v + lo,
+				sizeof(*results.v) * (results.amt - lo));
+		memcpy(results.v + lo, v, sizeof(*v) * amt);
+
+		/* Keep the same result selected, and the same results on the
+		 * screen.
+		 */
+		if (results.amt > 0 && lo <= results.sel)
+			results.sel += amt;
+		if (results.amt > 0 && lo <= results.top)
+			results.top += amt;
+		results.amt += amt;
+	}
+
+	pthread_mutex_unlock(&results.lock);
+
+	free(v);
+}
+
+/*
+ * The body of the thread that brings the trigram index at the path arg up to
+ * date with the files, and then gives it to search_all(). arg is freed. Even
+ * if the index cannot be written, the last one is still of use, because
+ * search_file_job() checks that a file is as it was when it was indexed.
+ */
+void *
+index_files(void *arg)
+{
+	char *const path = arg;
+	TrigramIndex *idx;
+	int *ids, i;
+
+	trigram_update(path, filel.v, filel.amt);
+
+	if ((idx = malloc(sizeof(*idx))) == NULL ||
+			(ids = malloc(sizeof(*ids) * bufl.amt)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	if (trigram_open(idx, path) == -1) {
+		free(ids);
+		free(idx);
+		free(path);
+		return NULL;
+	}
+
+	for (i = 0; i < bufl.amt; i++)
+		ids[i] = trigram_find(idx, filel.v[i]);
+
+	pthread_mutex_lock(&results.lock);
+	results.index = idx;
+	results.ids = ids;
+	pthread_mutex_unlock(&results.lock);
+
+	free(path);
+
+	return NULL;
+}
+
+/*
+ * Search every buffer for pattern, and show the results. The files are
+ * searched on the worker threads of their own pool, so that a search does
+ * not hold up the loading of buffers; the results are drawn as they come in.
+ * Files that the trigram index says do not have the pattern are passed over.
+ * If pattern is empty, the results of the last search are shown again.
+ */
+void
+search_all(const char *const pattern)
+{
+	const TrigramIndex *idx;
+	unsigned char *set;
+	Pattern *p;
+	SearchJob *j;
+	unsigned long gen;
+	int i, *ids;
+
+	if (pattern[0] == '\0') {
+		if (results.pattern == NULL)
+			message = "No previous search pattern";
+		else
+			results.open = 1;
+		return;
+	}
+
+	/* The results refer to buffers by their place in bufl, which changes
+	 * while files are being found.
+	 */
+	if (!discovery.settled) {
+		message = "Still finding files";
+		return;
+	}
+
+	if ((p = compile_pattern(pattern)) == NULL)
+		return;
+
+	if (results.pool == NULL)
+		results.pool = pool_create(0);
+
+	pthread_mutex_lock(&results.lock);
+
+	/* Jobs of the last search that are yet to run see that it is over. */
+	gen = ++results.gen;
+
+	for (i = 0; i < results.amt; i++)
+		free(results.v[i].text);
+	results.amt = results.sel = results.top = 0;
+	results.done = 0;
+	results.files = bufl.amt;
+
+	if (results.pattern != NULL)
+		pattern_put(results.pattern);
+	results.pattern = p;
+
+	idx = results.index;
+	ids = results.ids;
+
+	pthread_mutex_unlock(&results.lock);
+
+	results.open = 1;
+
+	/* The index only knows about literal patterns. */
+	set = NULL;
+	if (idx != NULL && !(pattern_flags(p) & PATTERN_REGEX)) {
+		if ((set = malloc(idx->nfiles + 1)) == NULL)
+			err(EXIT_FAILURE, "malloc failed");
+		if (trigram_candidates(idx, pattern, strlen(pattern), set) ==
+				-1) {
+			free(set);
+			set = NULL;
+		}
+	}
+
+	for (i = 0; i < bufl.amt; i++) {
+		if ((j = malloc(sizeof(*j))) == NULL)
+			err(EXIT_FAILURE, "malloc failed");
+		j->gen = gen;
+		j->buffer = i;
+		j->pattern = pattern_keep(p);
+		j->index = idx;
+		j->skip = set != NULL && ids[i] != -1 && !set[ids[i]] ?
+			ids[i] : -1;
+		pool_submit(results.pool, search_file_job, j);
+	}
+
+	free(set);
+}
+
+/*
+ * A job run on the worker threads of results.pool. Searches the file of the
+ * buffer given by the SearchJob at arg, which is then freed.
+ */
+static void
+search_file_job(void *arg)
+{
+	SearchJob *const j = arg;
+	Buffer *const b = bufl.v[j->buffer];
+	Buffer copy;
+	struct stat statbuf;
+	const Buffer *from;
+	int fd, stale;
+
+	pthread_mutex_lock(&results.lock);
+	stale = j->gen != results.gen;
+	pthread_mutex_unlock(&results.lock);
+
+	if (stale) {
+		pattern_put(j->pattern);
+		free(j);
+		return;
+	}
+
+	pthread_mutex_lock(&loader.lock);
+	from = b->state == LOADED ? b : NULL;
+	pthread_mutex_unlock(&loader.lock);
+
+	/* The file does not need to be read if the index says that it does not
+	 * have the pattern, and it has not changed since it was indexed.
+	 */
+	if (from == NULL && j->skip != -1 &&
+			stat(filel.v[j->buffer], &statbuf) == 0 &&
+			trigram_current(j->index, j->skip, &statbuf)) {
+		add_results(j, NULL, 0);
+		wake_up();
+		pattern_put(j->pattern);
+		free(j);
+		return;
+	}
+
+	/* Rather than load the buffer, which would keep it in memory, read the
+	 * file only for as long as it is being searched.
+	 */
+	if (from == NULL && (fd = open(filel.v[j->buffer], O_RDONLY)) != -1) {
+		if (fstat(fd, &statbuf) == 0 &&
+				((S_ISREG(statbuf.st_mode) &&
+				  map_buffer(&copy, fd,
+					  statbuf.st_size) == 0) ||
+				 read_buffer(&copy, fd) == 0))
+			from = &copy;
+		close(fd);
+	}
+
+	/* A loaded buffer is not added to while it is searched. */
+	if (from == b)
+		pthread_rwlock_rdlock(&loader.text);
+	if (from != NULL)
+		search_text(j, from->text, from->length);
+	else
+		add_results(j, NULL, 0);
+	if (from == b)
+		pthread_rwlock_unlock(&loader.text);
+
+	if (from == &copy) {
+		if (!copy.mapped)
+			free(copy.text);
+		else if (copy.text != NULL)
+			munmap(copy.text, copy.length);
+	}
+
+	wake_up();
+	pattern_put(j->pattern);
+	free(j);
+}
+
+/*
+ * Find every line of the 'length' bytes of text that has the pattern of the
+ * job j, and add them to results with add_results(). Only the first
+ * SNIPPET_MAX bytes of each line are kept.
+ */
+static void
+search_text(const SearchJob *const j, const char *const text,
+		const long length)
+{
+	Result *v;
+	const char *p;
+	char *snippet;
+	long pos, off, start, end, n, k;
+	int amt, size, line;
+	unsigned char c;
+
+	v = NULL;
+	amt = size = line = 0;
+
+	for (pos = 0; pos < length; pos = end + 1, line++) {
+		if ((off = pattern_next(j->pattern, text, pos, length, &end)) ==
+				-1)
+			break;
+
+		/* Count the lines passed over to get to the match. */
+		start = pos;
+		while ((p = memchr(text + start, '\n', off - start)) != NULL) {
+			start = p - text + 1;
+			line++;
+		}
+		p = memchr(text + off, '\n', length - off);
+		end = p == NULL ? length : p - text;
+
+		n = end - start;
+		if (n > SNIPPET_MAX) {
+			n = SNIPPET_MAX;
+			while (n > 0 && (text[start + n] & 0xc0) == 0x80)
+				n--;
+		}
+		if ((snippet = malloc(n + 1)) == NULL)
+			err(EXIT_FAILURE, "malloc failed");
+		for (k = 0; k < n; k++) {
+			/* Tabs and other control characters would move the
+			 * cursor off of the row.
+			 */
+			c = text[start + k];
+			snippet[k] = c < ' ' || c == 0x7f ? ' ' : c;
+		}
+		snippet[n] = '\0';
+
+		if (amt == size) {
+			size = size == 0 ? 16 : size * 2;
+			if ((v = realloc(v, sizeof(*v) * size)) == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		v[amt].buffer = j->buffer;
+		v[amt].line = line;
+		v[amt].text = snippet;
+		amt++;
+	}
+
+	add_results(j, v, amt);
+}
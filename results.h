@@ -0,0 +1,93 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <pthread.h>
+
+#include "pattern.h"
+#include "pool.h"
+#include "trigram.h"
+
+/*
+ * A line found by a search of every buffer. See search_all().
+ */
+typedef struct {
+	/* Index of the buffer that the line is in. */
+	int buffer;
+
+	/* Index of the line in the buffer. */
+	int line;
+
+	/* The text of the line, made safe to print on one row. */
+	char *text;
+} Result;
+
+/*
+ * The results of the last search of every buffer. These are added to by
+ * worker threads as they finish searching each file, and are shown in place of
+ * the current buffer while the search is open.
+ */
+typedef struct {
+	/* Guards everything else here. */
+	pthread_mutex_t lock;
+
+	/* The results, in the order of buffers and then of lines. */
+	Result *v;
+	int amt;
+
+	/* The amount of space allocated for v. */
+	int size;
+
+	/* Incremented by every search. Jobs of an older search stop early. */
+	unsigned long gen;
+
+	/* How many files have been searched, out of how many there are. */
+	int done;
+	int files;
+
+	/* The pattern searched for, or NULL if there has been no search. */
+	Pattern *pattern;
+
+	/* Index of the selected result, and of the result drawn at the top of
+	 * the screen.
+	 */
+	int sel;
+	int top;
+
+	/* Whether the results are shown instead of the current buffer. */
+	int open;
+
+	/* Runs the jobs of searches, apart from the loader's. */
+	Pool *pool;
+
+	/* The trigram index of the files, once index_files() has brought it up
+	 * to date, or NULL; and the index in it of the file of every buffer, or
+	 * -1 for those that are not in it.
+	 */
+	TrigramIndex *index;
+	int *ids;
+} Results;
+
+extern Results results;
+
+void *index_files(void *);
+void search_all(const char *const);
+
+#endif /* RESULTS_H */
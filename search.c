@@ -0,0 +1,151 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
+#include "search.h"
+
+/*
+ * Return c in lower case if ignoring case, and if it is an ASCII letter.
+ * Other characters, including those of multi-byte UTF-8 sequences, are
+ * returned as they are.
+ */
+static unsigned char
+fold(const unsigned char c, const int icase)
+{
+	return icase && c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/*
+ * Set the shift of the bad character table shift for c to v. If icase is
+ * nonzero, the shift is set for both cases of c.
+ */
+static void
+set_shift(long *const shift, const unsigned char c, const long v,
+		const int icase)
+{
+	shift[c] = v;
+	if (icase && c >= 'a' && c <= 'z')
+		shift[c - 'a' + 'A'] = v;
+	else if (icase && c >= 'A' && c <= 'Z')
+		shift[c - 'A' + 'a'] = v;
+}
+
+/*
+ * Find the first occurrence of the 'nlen' characters at n in the 'hlen'
+ * characters at h, using the Boyer-Moore-Horspool algorithm. If icase is
+ * nonzero, case is ignored. Returns the offset of the occurrence in h, or -1
+ * if there is none.
+ */
+static long
+horspool_forward(const unsigned char *const h, const long hlen,
+		const unsigned char *const n, const long nlen, const int icase)
+{
+	long shift[256], i, j, k;
+
+	/* How far the window can move when its last character is c: to line
+	 * the last occurrence of c in n, not counting its last character, up
+	 * with it.
+	 */
+	for (i = 0; i < 256; i++)
+		shift[i] = nlen;
+	for (k = 0; k < nlen - 1; k++)
+		set_shift(shift, n[k], nlen - 1 - k, icase);
+
+	for (j = 0; j + nlen <= hlen; j += shift[h[j + nlen - 1]]) {
+		for (k = nlen - 1;
+				k >= 0 && fold(h[j + k], icase) == fold(n[k], icase);
+				k--)
+			;
+		if (k < 0)
+			return j;
+	}
+
+	return -1;
+}
+
+#ifdef __SSE2__
+/*
+ * Like horspool_forward(), but case-sensitive, for needles at least two
+ * characters long, and sixteen windows at a time. Candidates are the windows
+ * whose first and last characters match those of n, which is tested for all
+ * sixteen at once with SSE2; only candidates are then compared in full.
+ */
+static long
+sse2_forward(const unsigned char *const h, const long hlen,
+		const unsigned char *const n, const long nlen)
+{
+	const __m128i first = _mm_set1_epi8(n[0]);
+	const __m128i last = _mm_set1_epi8(n[nlen - 1]);
+	__m128i a, b;
+	unsigned int mask;
+	long i, r;
+	int bit;
+
+	for (i = 0; i + nlen - 1 + 16 <= hlen; i += 16) {
+		a = _mm_loadu_si128((const __m128i *)(h + i));
+		b = _mm_loadu_si128((const __m128i *)(h + i + nlen - 1));
+		mask = _mm_movemask_epi8(_mm_and_si128(
+				_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+
+		for (bit = 0; mask != 0; bit++, mask >>= 1) {
+			if ((mask & 1) &&
+					memcmp(h + i + bit + 1, n + 1, nlen - 2) == 0)
+				return i + bit;
+		}
+	}
+
+	/* The windows left are too close to the end to load sixteen. */
+	r = horspool_forward(h + i, hlen - i, n, nlen, 0);
+
+	return r == -1 ? -1 : i + r;
+}
+#endif /* __SSE2__ */
+
+/*
+ * Find the first occurrence of the 'nlen' characters at n in the 'hlen'
+ * characters at h. If icase is nonzero, case is ignored. Returns the offset
+ * of the occurrence in h, or -1 if there is none.
+ */
+long
+search_forward(const char *const hay, const long hlen,
+		const char *const needle, const long nlen, const int icase)
+{
+	const unsigned char *const h = (const unsigned char *)hay;
+	const unsigned char *const n = (const unsigned char *)needle;
+	const unsigned char *p;
+
+	if (nlen == 0 || nlen > hlen)
+		return -1;
+
+	/* memchr(3) is already vectorized. */
+	if (nlen == 1 && !icase) {
+		p = memchr(h, n[0], hlen);
+		return p == NULL ? -1 : p - h;
+	}
+
+#ifdef __SSE2__
+	if (!icase)
+		return sse2_forward(h, hlen, n, nlen);
+#endif /* __SSE2__ */
+
+	return horspool_forward(h, hlen, n, nlen, icase);
+}
@@ -0,0 +1,201 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "filekey.h"
+#include "loader.h"
+#include "navipage.h"
+#include "stream.h"
+
+/* How many bytes of standard input are read at a time by read_stream(). */
+#define STREAM_CHUNK 65536
+
+/* What the buffer of standard input is called in the status bar. */
+#define STDIN_NAME "(standard input)"
+
+static void *read_stream(void *);
+
+Stream stream = {
+	PTHREAD_MUTEX_INITIALIZER,
+	NULL, NULL, 0, 0, 0, 0, 0, 0
+};
+
+/*
+ * Show standard input, which is described by st, as the only buffer. A regular
+ * file is mapped like any other; anything else, like a pipe, is read by
+ * read_stream() in the background, and shown as it comes in.
+ */
+void
+read_stdin(const struct stat *const st)
+{
+	static char name[] = STDIN_NAME;
+	Buffer *b;
+	pthread_t thread;
+
+	if ((b = calloc(1, sizeof(*b))) == NULL ||
+			(bufl.v = malloc(sizeof(*bufl.v))) == NULL ||
+			(filel.v = malloc(sizeof(*filel.v))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	filekey_init(&b->key, name);
+	b->state = LOADED;
+	bufl.v[0] = b;
+	filel.v[0] = b->key.path;
+	bufl.amt = bufl.size = filel.amt = filel.size = 1;
+
+	/* Only the whole of a file can be mapped, so one that has been read
+	 * from already is read like a pipe.
+	 */
+	stream.buffer = b;
+	if (S_ISREG(st->st_mode) && lseek(STDIN_FILENO, 0, SEEK_CUR) == 0 &&
+			map_buffer(b, STDIN_FILENO, st->st_size) == 0) {
+		index_buffer(b, st);
+		stream.settled = stream.file = 1;
+		return;
+	}
+
+	if (pthread_create(&thread, NULL, read_stream, NULL) != 0)
+		err(EXIT_FAILURE, "cannot pthread_create");
+	pthread_detach(thread);
+}
+
+/*
+ * The body of the thread that reads standard input, STREAM_CHUNK bytes at a
+ * time, until it ends. What it reads is handed to the main thread, which adds
+ * it to stream.buffer with take_stream().
+ */
+static void *
+read_stream(void *arg)
+{
+	char chunk[STREAM_CHUNK];
+	ssize_t n;
+	int first, error;
+
+	(void)arg;
+
+	for (;;) {
+		n = read(STDIN_FILENO, chunk, sizeof(chunk));
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+
+		pthread_mutex_lock(&stream.lock);
+		first = stream.amt == 0;
+
+		/* Double the space whenever it runs out, in case the main
+		 * thread is slow to take what has been read.
+		 */
+		if (stream.amt + n > stream.size) {
+			while (stream.amt + n > stream.size)
+				stream.size = stream.size == 0 ?
+					STREAM_CHUNK : stream.size * 2;
+			if ((stream.v = realloc(stream.v, stream.size)) ==
+					NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		memcpy(stream.v + stream.amt, chunk, n);
+		stream.amt += n;
+
+		pthread_mutex_unlock(&stream.lock);
+
+		/* The main thread only needs to be woken up once for all that
+		 * is read before it takes it.
+		 */
+		if (first)
+			wake_up();
+	}
+
+	error = n == -1 ? errno : 0;
+
+	pthread_mutex_lock(&stream.lock);
+	stream.done = 1;
+	stream.error = error;
+	pthread_mutex_unlock(&stream.lock);
+	wake_up();
+
+	return NULL;
+}
+
+/*
+ * Add what has been read of standard input since this was last called to the
+ * end of its buffer. Nothing is added while another thread reads a buffer;
+ * that thread wakes the main thread up once it is done. Returns nonzero if
+ * anything changed.
+ */
+int
+take_stream(void)
+{
+	static char error[128];
+	Buffer *const b = stream.buffer;
+	long old;
+	int done, errnum;
+
+	if (b == NULL || stream.settled)
+		return 0;
+
+	if (pthread_rwlock_trywrlock(&loader.text) != 0)
+		return 0;
+
+	pthread_mutex_lock(&stream.lock);
+
+	old = b->length;
+	if (stream.amt > 0) {
+		/* Double the space whenever it runs out, like read_buffer()
+		 * does.
+		 */
+		if (b->length + stream.amt > b->size) {
+			if (b->size == 0)
+				b->size = TEXT_SIZE_INIT;
+			while (b->length + stream.amt > b->size)
+				b->size *= 2;
+			b->text = realloc(b->text, sizeof(*b->text) * b->size);
+			if (b->text == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		memcpy(b->text + b->length, stream.v, stream.amt);
+		b->length += stream.amt;
+		stream.amt = 0;
+	}
+	done = stream.done;
+	errnum = stream.error;
+
+	pthread_mutex_unlock(&stream.lock);
+
+	grow_buffer(b, old);
+
+	pthread_rwlock_unlock(&loader.text);
+
+	if (done) {
+		stream.settled = 1;
+		if (errnum != 0) {
+			snprintf(error, sizeof(error), "cannot read %s: %s",
+					STDIN_NAME, strerror(errnum));
+			message = error;
+		}
+	}
+
+	return b->length > old || done;
+}
@@ -0,0 +1,68 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "navipage.h"
+
+/*
+ * Reads standard input on a thread of its own, so that what has been read of
+ * it can be shown while the rest is still being written. See read_stream().
+ */
+typedef struct {
+	/* Guards v, amt, size, done and error. */
+	pthread_mutex_t lock;
+
+	/* The buffer of standard input, or NULL if it is not shown. */
+	Buffer *buffer;
+
+	/* What has been read since the main thread last took it with
+	 * take_stream(), and the amount of space allocated for it.
+	 */
+	char *v;
+	long amt;
+	long size;
+
+	/* Whether the end of the input has been reached, and the error that
+	 * ended it, or 0.
+	 */
+	int done;
+	int error;
+
+	/* Whether the main thread has taken all of the input, which it has
+	 * from the start if the input was mapped. This is only used by the
+	 * main thread, and needs no lock.
+	 */
+	int settled;
+
+	/* Whether the input is a whole regular file, which was mapped rather
+	 * than read, and can be followed like any other. See follow_buffer().
+	 */
+	int file;
+} Stream;
+
+extern Stream stream;
+
+void read_stdin(const struct stat *const);
+int take_stream(void);
+
+#endif /* STREAM_H */
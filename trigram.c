@@ -0,0 +1,715 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "trigram.h"
+
+/* Identifies a file as a trigram index of this layout. Bump the version
+ * whenever the layout changes, so that old indexes are rebuilt.
+ */
+#define MAGIC "NPTI"
+#define VERSION_TRIGRAM 1
+
+/* How many trigrams there can be: one for every three bytes. */
+#define TRIGRAMS (1L << 24)
+
+/* The most trigrams of a pattern that are looked up. A pattern with more is
+ * only narrowed down by the first of them, which is still correct.
+ */
+#define PATTERN_TRIGRAMS_MAX 255
+
+/*
+ * The start of an index file. It is followed by nfiles TrigramFiles,
+ * ntrigrams TrigramEntries, npostings file indices, and then pathsize bytes of
+ * paths, each of which ends in a null byte.
+ */
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t nfiles;
+	uint32_t ntrigrams;
+	uint32_t npostings;
+	uint32_t pathsize;
+
+	/* Keeps the files that follow aligned. */
+	uint32_t pad[2];
+} Header;
+
+/*
+ * A file being put in a new index by trigram_update().
+ */
+typedef struct {
+	const char *path;
+	uint64_t size;
+	int64_t sec, nsec;
+
+	/* The sorted trigrams of the file. */
+	const uint32_t *v;
+	uint32_t amt;
+
+	/* Whether v was allocated for this file, rather than taken from the
+	 * old index.
+	 */
+	int owned;
+} Item;
+
+static int compare_items(const void *, const void *);
+static int compare_trigrams(const void *, const void *);
+static int find_item(const Item *const, const int, const char *const);
+static unsigned char fold(const unsigned char);
+static uint32_t *invert(const TrigramIndex *const, uint32_t **const);
+static int popcount(uint64_t);
+static void scan(Item *const, const char *const, uint64_t *const);
+static int write_index(const char *const, const Item *const, const int);
+
+/*
+ * qsort(3) comparator of Items by path.
+ */
+static int
+compare_items(const void *p1, const void *p2)
+{
+	return strcmp(((const Item *)p1)->path, ((const Item *)p2)->path);
+}
+
+/*
+ * qsort(3) comparator of trigrams.
+ */
+static int
+compare_trigrams(const void *p1, const void *p2)
+{
+	const uint32_t t1 = *(const uint32_t *)p1, t2 = *(const uint32_t *)p2;
+
+	return (t1 > t2) - (t1 < t2);
+}
+
+/*
+ * Return the index of the Item with path in the 'amt' sorted Items at v, or
+ * -1 if there is none.
+ */
+static int
+find_item(const Item *const v, const int amt, const char *const path)
+{
+	int lo, hi, mid, cmp;
+
+	lo = 0;
+	hi = amt;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if ((cmp = strcmp(v[mid].path, path)) == 0)
+			return mid;
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return -1;
+}
+
+/*
+ * Fold an ASCII letter to lowercase, so that the index serves searches that
+ * ignore case as well as those that don't.
+ */
+static unsigned char
+fold(const unsigned char c)
+{
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/*
+ * Turn the postings of idx inside out, into the sorted trigrams of every file.
+ * The trigrams of the 'i'-th file are from (*start)[i] up to (*start)[i + 1]
+ * in the returned array. Both arrays must be freed by the caller.
+ */
+static uint32_t *
+invert(const TrigramIndex *const idx, uint32_t **const start)
+{
+	const TrigramEntry *e;
+	uint32_t *v, *at, i, k, p;
+
+	if ((*start = calloc(idx->nfiles + 1, sizeof(**start))) == NULL ||
+			(at = malloc(sizeof(*at) * (idx->nfiles + 1))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	for (i = 0; i < idx->ntrigrams; i++) {
+		e = &idx->trigrams[i];
+		for (k = 0; k < e->amt; k++)
+			(*start)[idx->postings[e->off + k] + 1]++;
+	}
+	for (i = 0; i < idx->nfiles; i++)
+		(*start)[i + 1] += (*start)[i];
+
+	if ((v = malloc(sizeof(*v) * ((*start)[idx->nfiles] + 1))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	/* Going through the trigrams in order leaves every file's sorted. */
+	memcpy(at, *start, sizeof(*at) * (idx->nfiles + 1));
+	for (i = 0; i < idx->ntrigrams; i++) {
+		e = &idx->trigrams[i];
+		for (k = 0; k < e->amt; k++) {
+			p = idx->postings[e->off + k];
+			v[at[p]++] = e->trigram;
+		}
+	}
+
+	free(at);
+
+	return v;
+}
+
+/*
+ * Return how many bits of x are set.
+ */
+static int
+popcount(uint64_t x)
+{
+	x = x - ((x >> 1) & 0x5555555555555555);
+	x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0f;
+
+	return (x * 0x0101010101010101) >> 56;
+}
+
+/*
+ * Fill in the trigrams of it from text, which is it->size bytes long. seen is
+ * a bitmap of every trigram, which must be clear, and is left clear.
+ */
+static void
+scan(Item *const it, const char *const text, uint64_t *const seen)
+{
+	uint32_t *v, t;
+	uint64_t i;
+	int size;
+
+	v = NULL;
+	it->amt = size = 0;
+
+	for (i = 0; i + 2 < it->size; i++) {
+		/* A match cannot span lines, so neither does a trigram. */
+		if (text[i + 2] == '\n') {
+			i += 2;
+			continue;
+		}
+		if (text[i + 1] == '\n') {
+			i++;
+			continue;
+		}
+		if (text[i] == '\n')
+			continue;
+
+		t = (uint32_t)fold(text[i]) << 16 |
+			(uint32_t)fold(text[i + 1]) << 8 | fold(text[i + 2]);
+		if (seen[t >> 6] & (uint64_t)1 << (t & 63))
+			continue;
+		seen[t >> 6] |= (uint64_t)1 << (t & 63);
+
+		if ((int)it->amt == size) {
+			size = size == 0 ? 1024 : size * 2;
+			if ((v = realloc(v, sizeof(*v) * size)) == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		v[it->amt++] = t;
+	}
+
+	for (i = 0; i < it->amt; i++)
+		seen[v[i] >> 6] = 0;
+
+	qsort(v, it->amt, sizeof(*v), compare_trigrams);
+
+	it->v = v;
+	it->owned = 1;
+}
+
+/*
+ * Write an index of the 'amt' Items at v, which are sorted by path, to path.
+ * The index is written to a temporary file that then replaces path, so that
+ * it is never seen half-written. Returns 0 on success, -1 on error.
+ */
+static int
+write_index(const char *const path, const Item *const v, const int amt)
+{
+	Header h;
+	TrigramFile *files;
+	TrigramEntry *entries;
+	uint64_t *bits, npostings, pathsize;
+	uint32_t *rank, *postings, *at, t, r, ntrigrams;
+	char *tmp;
+	FILE *fp;
+	long w;
+	int i, fd, failed, ret;
+	uint32_t k;
+
+	ret = -1;
+	entries = NULL;
+	postings = NULL;
+
+	/* Find every trigram that any file has, and give each a rank, which is
+	 * how many come before it.
+	 */
+	if ((bits = calloc(TRIGRAMS / 64, sizeof(*bits))) == NULL ||
+			(rank = malloc(sizeof(*rank) * (TRIGRAMS / 64))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	npostings = pathsize = 0;
+	for (i = 0; i < amt; i++) {
+		for (k = 0; k < v[i].amt; k++)
+			bits[v[i].v[k] >> 6] |= (uint64_t)1 << (v[i].v[k] & 63);
+		npostings += v[i].amt;
+		pathsize += strlen(v[i].path) + 1;
+	}
+	if (npostings > UINT32_MAX || pathsize > UINT32_MAX) {
+		free(bits);
+		free(rank);
+		return -1;
+	}
+
+	ntrigrams = 0;
+	for (w = 0; w < TRIGRAMS / 64; w++) {
+		rank[w] = ntrigrams;
+		ntrigrams += popcount(bits[w]);
+	}
+
+	if ((files = malloc(sizeof(*files) * (amt + 1))) == NULL ||
+			(entries = calloc(ntrigrams + 1, sizeof(*entries))) ==
+			NULL ||
+			(postings = malloc(sizeof(*postings) *
+					(npostings + 1))) == NULL ||
+			(at = malloc(sizeof(*at) * (ntrigrams + 1))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	/* Count the files of each trigram, then lay the lists out one after
+	 * the other.
+	 */
+	for (i = 0; i < amt; i++) {
+		for (k = 0; k < v[i].amt; k++) {
+			t = v[i].v[k];
+			r = rank[t >> 6] + popcount(bits[t >> 6] &
+					(((uint64_t)1 << (t & 63)) - 1));
+			entries[r].trigram = t;
+			entries[r].amt++;
+		}
+	}
+	for (r = 0, t = 0; r < ntrigrams; r++) {
+		entries[r].off = t;
+		at[r] = t;
+		t += entries[r].amt;
+	}
+
+	/* Going through the files in order leaves every list sorted. */
+	pathsize = 0;
+	for (i = 0; i < amt; i++) {
+		for (k = 0; k < v[i].amt; k++) {
+			t = v[i].v[k];
+			r = rank[t >> 6] + popcount(bits[t >> 6] &
+					(((uint64_t)1 << (t & 63)) - 1));
+			postings[at[r]++] = i;
+		}
+		files[i].size = v[i].size;
+		files[i].sec = v[i].sec;
+		files[i].nsec = v[i].nsec;
+		files[i].pathoff = pathsize;
+		files[i].pathlen = strlen(v[i].path);
+		pathsize += files[i].pathlen + 1;
+	}
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, MAGIC, sizeof(h.magic));
+	h.version = VERSION_TRIGRAM;
+	h.nfiles = amt;
+	h.ntrigrams = ntrigrams;
+	h.npostings = npostings;
+	h.pathsize = pathsize;
+
+	if ((tmp = malloc(strlen(path) + sizeof(".XXXXXX"))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	sprintf(tmp, "%s.XXXXXX", path);
+
+	if ((fd = mkstemp(tmp)) != -1) {
+		if ((fp = fdopen(fd, "w")) == NULL) {
+			close(fd);
+		} else {
+			fwrite(&h, sizeof(h), 1, fp);
+			fwrite(files, sizeof(*files), amt, fp);
+			fwrite(entries, sizeof(*entries), ntrigrams, fp);
+			fwrite(postings, sizeof(*postings), npostings, fp);
+			for (i = 0; i < amt; i++)
+				fwrite(v[i].path, 1, files[i].pathlen + 1, fp);
+			failed = ferror(fp);
+			if (fclose(fp) == 0 && !failed &&
+					rename(tmp, path) == 0)
+				ret = 0;
+		}
+		if (ret == -1)
+			unlink(tmp);
+	}
+
+	free(tmp);
+	free(at);
+	free(postings);
+	free(entries);
+	free(files);
+	free(rank);
+	free(bits);
+
+	return ret;
+}
+
+/*
+ * Find which files of idx may have the 'len' characters at pattern, and set
+ * the byte of each in set, which must have room for idx->nfiles bytes, to 1;
+ * the others are set to 0. Returns how many files may have the pattern, or
+ * -1 if the pattern is too short to have trigrams, in which case any file
+ * may have it and set is left alone.
+ */
+int
+trigram_candidates(const TrigramIndex *const idx, const char *const pattern,
+		const long len, unsigned char *const set)
+{
+	uint32_t want[PATTERN_TRIGRAMS_MAX], t, k, p;
+	const TrigramEntry *e;
+	long i, n, m, lo, hi, mid;
+	int amt;
+
+	if (len < 3)
+		return -1;
+
+	n = 0;
+	for (i = 0; i + 2 < len && n < PATTERN_TRIGRAMS_MAX; i++)
+		want[n++] = (uint32_t)fold(pattern[i]) << 16 |
+			(uint32_t)fold(pattern[i + 1]) << 8 |
+			fold(pattern[i + 2]);
+	qsort(want, n, sizeof(*want), compare_trigrams);
+	for (i = m = 0; i < n; i++)
+		if (m == 0 || want[m - 1] != want[i])
+			want[m++] = want[i];
+
+	/* After the 'i'-th trigram, a file's byte is i + 1 if it has all of
+	 * them so far.
+	 */
+	memset(set, 0, idx->nfiles);
+	for (i = 0; i < m; i++) {
+		t = want[i];
+		lo = 0;
+		hi = idx->ntrigrams;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (idx->trigrams[mid].trigram < t)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo == (long)idx->ntrigrams ||
+				idx->trigrams[lo].trigram != t) {
+			/* No file has this trigram. */
+			memset(set, 0, idx->nfiles);
+			return 0;
+		}
+
+		e = &idx->trigrams[lo];
+		for (k = 0; k < e->amt; k++) {
+			p = idx->postings[e->off + k];
+			if (set[p] == i)
+				set[p] = i + 1;
+		}
+	}
+
+	amt = 0;
+	for (k = 0; k < idx->nfiles; k++)
+		amt += set[k] = set[k] == m;
+
+	return amt;
+}
+
+/*
+ * Unmap the index idx.
+ */
+void
+trigram_close(TrigramIndex *const idx)
+{
+	if (idx->map != NULL)
+		munmap(idx->map, idx->size);
+	idx->map = NULL;
+}
+
+/*
+ * Return whether the 'i'-th file of idx is as it was when it was indexed,
+ * judging by st, the information of the file as it is now.
+ */
+int
+trigram_current(const TrigramIndex *const idx, const int i,
+		const struct stat *const st)
+{
+	const TrigramFile *const f = &idx->files[i];
+
+	return f->size == (uint64_t)st->st_size &&
+		f->sec == (int64_t)st->st_mtim.tv_sec &&
+		f->nsec == (int64_t)st->st_mtim.tv_nsec;
+}
+
+/*
+ * Return the index of the file at path in idx, or -1 if it is not in it.
+ */
+int
+trigram_find(const TrigramIndex *const idx, const char *const path)
+{
+	long lo, hi, mid;
+	int cmp;
+
+	lo = 0;
+	hi = idx->nfiles;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		cmp = strcmp(idx->paths + idx->files[mid].pathoff, path);
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return -1;
+}
+
+/*
+ * Map the index at path into idx. Returns 0 on success, or -1 if it cannot be
+ * read or is not an index of this layout.
+ */
+int
+trigram_open(TrigramIndex *const idx, const char *const path)
+{
+	struct stat statbuf;
+	const Header *h;
+	uint64_t want;
+	uint32_t i;
+	void *p;
+	int fd;
+
+	idx->map = NULL;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+	if (fstat(fd, &statbuf) == -1 ||
+			statbuf.st_size < (off_t)sizeof(*h) ||
+			(p = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE,
+				  fd, 0)) == MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+	close(fd);
+
+	idx->map = p;
+	idx->size = statbuf.st_size;
+
+	h = p;
+	want = sizeof(*h) + (uint64_t)h->nfiles * sizeof(TrigramFile) +
+		(uint64_t)h->ntrigrams * sizeof(TrigramEntry) +
+		(uint64_t)h->npostings * sizeof(uint32_t) + h->pathsize;
+	if (memcmp(h->magic, MAGIC, sizeof(h->magic)) != 0 ||
+			h->version != VERSION_TRIGRAM ||
+			want != (uint64_t)statbuf.st_size)
+		return (trigram_close(idx), -1);
+
+	idx->nfiles = h->nfiles;
+	idx->ntrigrams = h->ntrigrams;
+	idx->files = (const TrigramFile *)(h + 1);
+	idx->trigrams = (const TrigramEntry *)(idx->files + idx->nfiles);
+	idx->postings = (const uint32_t *)(idx->trigrams + idx->ntrigrams);
+	idx->paths = (const char *)(idx->postings + h->npostings);
+
+	/* Check that nothing points outside of the index, so that a damaged
+	 * one is rebuilt rather than crashing the program.
+	 */
+	for (i = 0; i < idx->nfiles; i++)
+		if ((uint64_t)idx->files[i].pathoff + idx->files[i].pathlen >=
+				h->pathsize ||
+				idx->paths[idx->files[i].pathoff +
+				idx->files[i].pathlen] != '\0')
+			return (trigram_close(idx), -1);
+	for (i = 0; i < idx->ntrigrams; i++)
+		if ((uint64_t)idx->trigrams[i].off + idx->trigrams[i].amt >
+				h->npostings)
+			return (trigram_close(idx), -1);
+	for (i = 0; i < h->npostings; i++)
+		if (idx->postings[i] >= idx->nfiles)
+			return (trigram_close(idx), -1);
+
+	return 0;
+}
+
+/*
+ * Bring the index at path up to date with the 'amt' files at paths, and write
+ * it back. Files that are the same size and were modified at the same time as
+ * when they were indexed are not read again. Files that were indexed before,
+ * but are not among paths, are kept as long as they are still current.
+ * Returns 0 on success, -1 on error.
+ */
+int
+trigram_update(const char *const path, char *const *const paths,
+		const int amt)
+{
+	TrigramIndex old;
+	struct stat statbuf;
+	Item *v, *it;
+	uint64_t *seen;
+	uint32_t *oldv, *oldstart;
+	char *text;
+	size_t textsize;
+	ssize_t got;
+	uint64_t have;
+	int n, i, j, fd, haveold, fresh, ret;
+
+	haveold = trigram_open(&old, path) == 0;
+	oldv = oldstart = NULL;
+	if (haveold)
+		oldv = invert(&old, &oldstart);
+
+	if ((v = malloc(sizeof(*v) * (amt + (haveold ? old.nfiles : 0) + 1)))
+			== NULL ||
+			(seen = calloc(TRIGRAMS / 64, sizeof(*seen))) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+
+	text = NULL;
+	textsize = 0;
+	n = fresh = 0;
+	for (i = 0; i < amt; i++) {
+		if (stat(paths[i], &statbuf) == -1 ||
+				!S_ISREG(statbuf.st_mode))
+			continue;
+
+		it = &v[n];
+		it->path = paths[i];
+		it->size = statbuf.st_size;
+		it->sec = statbuf.st_mtim.tv_sec;
+		it->nsec = statbuf.st_mtim.tv_nsec;
+		it->v = NULL;
+		it->amt = 0;
+		it->owned = 0;
+
+		if (haveold && (j = trigram_find(&old, paths[i])) != -1 &&
+				trigram_current(&old, j, &statbuf)) {
+			it->v = oldv + oldstart[j];
+			it->amt = oldstart[j + 1] - oldstart[j];
+			n++;
+			continue;
+		}
+
+		if (it->size == 0) {
+			fresh++;
+			n++;
+			continue;
+		}
+
+		/* The file is read rather than mapped, because it may get
+		 * shorter while it is scanned, and touching a mapping past its
+		 * end would kill the program.
+		 */
+		if ((fd = open(paths[i], O_RDONLY)) == -1)
+			continue;
+		if (it->size > textsize) {
+			textsize = it->size;
+			if ((text = realloc(text, textsize)) == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		got = 0;
+		for (have = 0; have < it->size; have += got) {
+			got = read(fd, text + have, it->size - have);
+			if (got == -1 && errno == EINTR)
+				got = 0;
+			else if (got <= 0)
+				break;
+		}
+		close(fd);
+
+		/* A file that got shorter while it was read is left out, to
+		 * be indexed once it stops changing. Until then, searches read
+		 * it, as they do any file that the index does not have.
+		 */
+		if (got == -1 || have < it->size)
+			continue;
+		scan(it, text, seen);
+		fresh++;
+		n++;
+	}
+	free(text);
+
+	qsort(v, n, sizeof(*v), compare_items);
+
+	/* The same file may have been given twice. */
+	for (i = j = 0; i < n; i++) {
+		if (j > 0 && strcmp(v[j - 1].path, v[i].path) == 0) {
+			if (v[i].owned)
+				free((uint32_t *)v[i].v);
+			continue;
+		}
+		v[j++] = v[i];
+	}
+	n = j;
+
+	/* Keep what is still true of files indexed before. */
+	j = n;
+	for (i = 0; haveold && i < (int)old.nfiles; i++) {
+		it = &v[j];
+		it->path = old.paths + old.files[i].pathoff;
+		if (find_item(v, n, it->path) != -1 ||
+				stat(it->path, &statbuf) == -1 ||
+				!trigram_current(&old, i, &statbuf))
+			continue;
+		it->size = old.files[i].size;
+		it->sec = old.files[i].sec;
+		it->nsec = old.files[i].nsec;
+		it->v = oldv + oldstart[i];
+		it->amt = oldstart[i + 1] - oldstart[i];
+		it->owned = 0;
+		j++;
+	}
+	n = j;
+	qsort(v, n, sizeof(*v), compare_items);
+
+	/* If every file was taken from the index, and it has no others, the
+	 * index is already up to date.
+	 */
+	if (haveold && fresh == 0 && n == (int)old.nfiles)
+		ret = 0;
+	else
+		ret = write_index(path, v, n);
+
+	for (i = 0; i < n; i++)
+		if (v[i].owned)
+			free((uint32_t *)v[i].v);
+	free(seen);
+	free(v);
+	free(oldv);
+	free(oldstart);
+	if (haveold)
+		trigram_close(&old);
+
+	return ret;
+}
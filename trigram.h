@@ -0,0 +1,80 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+/*
+ * A file in a trigram index, as it was when it was indexed.
+ */
+typedef struct {
+	uint64_t size;
+	int64_t sec, nsec;
+
+	/* Where the path of the file is in the paths of the index. */
+	uint32_t pathoff;
+	uint32_t pathlen;
+} TrigramFile;
+
+/*
+ * A trigram, and where the list of files that have it is in the postings of
+ * the index.
+ */
+typedef struct {
+	uint32_t trigram;
+	uint32_t off;
+	uint32_t amt;
+} TrigramEntry;
+
+/*
+ * An inverted index of which files have each trigram, which is every three
+ * characters in a row in a line, with ASCII letters folded to lowercase. A
+ * file that has every trigram of a pattern may have it; a file without one of
+ * them does not.
+ *
+ * The index is kept in one file, which is mapped into memory as it is. The
+ * members below point into the mapping.
+ */
+typedef struct {
+	void *map;
+	long size;
+
+	/* The files, sorted by path. Postings refer to them by index. */
+	const TrigramFile *files;
+	uint32_t nfiles;
+	const char *paths;
+
+	/* The trigrams, sorted, and the lists of files that they point to. */
+	const TrigramEntry *trigrams;
+	uint32_t ntrigrams;
+	const uint32_t *postings;
+} TrigramIndex;
+
+int trigram_candidates(const TrigramIndex *const, const char *const,
+		const long, unsigned char *const);
+void trigram_close(TrigramIndex *const);
+int trigram_current(const TrigramIndex *const, const int,
+		const struct stat *const);
+int trigram_find(const TrigramIndex *const, const char *const);
+int trigram_open(TrigramIndex *const, const char *const);
+int trigram_update(const char *const, char *const *const, const int);
+
+#endif /* TRIGRAM_H */
@@ -0,0 +1,373 @@
+/*
+ * navipage - multi-file pager for watching YouTube videos
+ * Copyright (C) 2021-2022 Sebastian LaVine <mail@smlavine.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* d_type, and the DT_ constants, are not in POSIX. */
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "pool.h"
+#include "walk.h"
+
+/* How many directories of a walk may be held open while they wait to be read.
+ * Any others are opened by their paths once they are read.
+ */
+#define DIRS_OPEN_MAX 256
+
+/*
+ * What is shared by every directory of one walk.
+ */
+typedef struct {
+	/* Guards everything below, and calls to add. */
+	pthread_mutex_t lock;
+
+	/* Signalled when pending drops to 0. */
+	pthread_cond_t cond;
+
+	/* How many directories have yet to be read. */
+	int pending;
+
+	/* Whether part of the tree could not be read. */
+	int failed;
+
+	/* How many directories are held open by their parents. See
+	 * open_directory().
+	 */
+	int open;
+
+	/* What to call with the path of each regular file, and with what. */
+	void (*add)(const char *const, void *);
+	void *arg;
+
+	/* The path of the file being handed to add. It is kept in one buffer,
+	 * so that the paths are not allocated one by one.
+	 */
+	char *path;
+	size_t pathsize;
+
+	Pool *pool;
+} Walk;
+
+/*
+ * A directory of a walk, which is read as a job of its own. See
+ * read_directory().
+ */
+typedef struct {
+	Walk *walk;
+
+	/* The path of the directory. */
+	char *path;
+
+	/* The directory, if its parent opened it while it was open; otherwise
+	 * -1.
+	 */
+	int fd;
+
+	/* The names of the regular files in the directory, in the order
+	 * readdir(3) gave them, one after another, each ending in a null
+	 * byte, so that a directory makes a few allocations rather than one
+	 * for every file.
+	 */
+	char *names;
+	size_t namelen;
+	size_t namesize;
+} Dir;
+
+static void add_name(Dir *const, const char *const);
+static void finish(Dir *const);
+static void new_directory(Walk *const, const char *const, const size_t,
+		const char *const, const int);
+static int open_directory(Walk *const, const int, const char *const);
+static void read_directory(void *);
+
+/*
+ * Keep the name of a regular file of d, to be handed over by finish().
+ */
+static void
+add_name(Dir *const d, const char *const name)
+{
+	const size_t len = strlen(name) + 1;
+
+	if (d->namelen + len > d->namesize) {
+		while (d->namelen + len > d->namesize)
+			d->namesize = d->namesize == 0 ? 256 :
+				d->namesize * 2;
+		if ((d->names = realloc(d->names, d->namesize)) == NULL)
+			err(EXIT_FAILURE, "realloc failed");
+	}
+
+	memcpy(d->names + d->namelen, name, len);
+	d->namelen += len;
+}
+
+/*
+ * Hand the regular files of d, which has been read, to the add function of its
+ * walk all at once, and free d, waking walk() up if it was the last directory
+ * to be read.
+ */
+static void
+finish(Dir *const d)
+{
+	Walk *const w = d->walk;
+	const size_t len = strlen(d->path);
+	const char *name;
+	size_t namelen;
+
+	pthread_mutex_lock(&w->lock);
+
+	for (name = d->names; name < d->names + d->namelen;
+			name += namelen + 1) {
+		namelen = strlen(name);
+		if (len + namelen + 2 > w->pathsize) {
+			while (len + namelen + 2 > w->pathsize)
+				w->pathsize *= 2;
+			if ((w->path = realloc(w->path, w->pathsize)) == NULL)
+				err(EXIT_FAILURE, "realloc failed");
+		}
+		memcpy(w->path, d->path, len);
+		w->path[len] = '/';
+		memcpy(w->path + len + 1, name, namelen + 1);
+
+		w->add(w->path, w->arg);
+	}
+
+	if (--w->pending == 0)
+		pthread_cond_signal(&w->cond);
+
+	pthread_mutex_unlock(&w->lock);
+
+	free(d->path);
+	free(d->names);
+	free(d);
+}
+
+/*
+ * Make a directory of the walk w, whose path is the 'len' bytes at parent
+ * followed by name, or only parent if name is NULL, and submit it to be read.
+ * fd is the directory, if it is already open, or -1.
+ */
+static void
+new_directory(Walk *const w, const char *const parent, const size_t len,
+		const char *const name, const int fd)
+{
+	Dir *d;
+	size_t namelen;
+
+	if ((d = calloc(1, sizeof(*d))) == NULL)
+		err(EXIT_FAILURE, "calloc failed");
+	d->walk = w;
+	d->fd = fd;
+
+	namelen = name == NULL ? 0 : strlen(name) + 1;
+	if ((d->path = malloc(len + namelen + 1)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	memcpy(d->path, parent, len);
+	if (name != NULL) {
+		d->path[len] = '/';
+		memcpy(d->path + len + 1, name, namelen);
+	} else {
+		d->path[len] = '\0';
+	}
+
+	pthread_mutex_lock(&w->lock);
+	w->pending++;
+	pthread_mutex_unlock(&w->lock);
+
+	pool_submit(w->pool, read_directory, d);
+}
+
+/*
+ * Open the directory called name in the one open at fd, with openat(2), so
+ * that its path is not looked up again from the start, unless DIRS_OPEN_MAX
+ * directories of w are held open already. Returns the new file descriptor, or
+ * -1 if the directory was not opened, in which case read_directory() opens it
+ * by its path.
+ */
+static int
+open_directory(Walk *const w, const int fd, const char *const name)
+{
+	int new;
+
+	pthread_mutex_lock(&w->lock);
+	if (w->open >= DIRS_OPEN_MAX) {
+		pthread_mutex_unlock(&w->lock);
+		return -1;
+	}
+	w->open++;
+	pthread_mutex_unlock(&w->lock);
+
+	if ((new = openat(fd, name, O_RDONLY | O_DIRECTORY)) == -1) {
+		pthread_mutex_lock(&w->lock);
+		w->open--;
+		pthread_mutex_unlock(&w->lock);
+	}
+
+	return new;
+}
+
+/*
+ * A job run on the threads of a walk's pool. Reads the directory at arg, and
+ * submits each directory in it to be read in turn, opened through
+ * open_directory() while this one is open. The entries of the directory are
+ * looked at relative to it, with fstatat(2), so that the path is not looked up
+ * again from the start for every file; and the type of an entry is taken from
+ * its d_type, when the file system gives one, so that most entries are never
+ * stat'd at all.
+ */
+static void
+read_directory(void *arg)
+{
+	Dir *const dir = arg;
+	Walk *const w = dir->walk;
+	const size_t len = strlen(dir->path);
+	struct dirent *d;
+	struct stat statbuf;
+	DIR *dirp;
+	mode_t mode;
+	int fd, known, failed;
+
+	if ((fd = dir->fd) != -1) {
+		pthread_mutex_lock(&w->lock);
+		w->open--;
+		pthread_mutex_unlock(&w->lock);
+	} else {
+		fd = open(dir->path, O_RDONLY | O_DIRECTORY);
+	}
+
+	dirp = NULL;
+	if (fd == -1 || (dirp = fdopendir(fd)) == NULL) {
+		ewarn("cannot opendir %s", dir->path);
+		if (fd != -1)
+			close(fd);
+		pthread_mutex_lock(&w->lock);
+		w->failed = 1;
+		pthread_mutex_unlock(&w->lock);
+		finish(dir);
+		return;
+	}
+
+	failed = 0;
+	for (;;) {
+		/* Reset errno in order to detect readdir errors. */
+		errno = 0;
+		if ((d = readdir(dirp)) == NULL)
+			break;
+
+		/* Exclude "." and ".." to avoid infinite recursion. */
+		if (strcmp(d->d_name, ".") == 0 ||
+				strcmp(d->d_name, "..") == 0)
+			continue;
+
+#ifdef DT_UNKNOWN
+		/* Symbolic links are followed, like stat(2) would. */
+		known = d->d_type != DT_UNKNOWN && d->d_type != DT_LNK;
+		mode = DTTOIF(d->d_type);
+#else
+		known = 0;
+		mode = 0;
+#endif
+		if (!known) {
+			if (fstatat(dirfd(dirp), d->d_name, &statbuf, 0) ==
+					-1) {
+				ewarn("cannot stat %s/%s", dir->path,
+						d->d_name);
+				failed = 1;
+				continue;
+			}
+			mode = statbuf.st_mode;
+		}
+
+		if (S_ISDIR(mode)) {
+			new_directory(w, dir->path, len, d->d_name,
+					open_directory(w, dirfd(dirp),
+						d->d_name));
+		} else if (S_ISREG(mode)) {
+			add_name(dir, d->d_name);
+		} else {
+			warn("cannot read %s/%s: not a regular file\n",
+					dir->path, d->d_name);
+			failed = 1;
+		}
+	}
+
+	if (errno != 0) {
+		ewarn("cannot readdir %s", dir->path);
+		failed = 1;
+	}
+
+	closedir(dirp);
+
+	if (failed) {
+		pthread_mutex_lock(&w->lock);
+		w->failed = 1;
+		pthread_mutex_unlock(&w->lock);
+	}
+	finish(dir);
+}
+
+/*
+ * Walk the directory called dir, and every directory under it, calling add
+ * with the path of each regular file in them and arg. The paths start with
+ * dir. The directories are read at once on the threads of pool, and add is
+ * called on those threads, one call at a time, as soon as each directory has
+ * been read; so files come in the order of their directory, but the
+ * directories come in no particular order. Files that cannot be read are
+ * warned about and passed over. Returns once every directory has been read:
+ * 0 on success, and -1 if any part of the tree could not be read.
+ */
+int
+walk(const char *const dir, Pool *const pool,
+		void (*add)(const char *const, void *), void *arg)
+{
+	Walk w;
+
+	if ((errno = pthread_mutex_init(&w.lock, NULL)) != 0 ||
+			(errno = pthread_cond_init(&w.cond, NULL)) != 0)
+		err(EXIT_FAILURE, "cannot initialize walk");
+	w.pending = 0;
+	w.failed = 0;
+	w.open = 0;
+	w.add = add;
+	w.arg = arg;
+	w.pathsize = strlen(dir) + 256;
+	if ((w.path = malloc(w.pathsize)) == NULL)
+		err(EXIT_FAILURE, "malloc failed");
+	w.pool = pool;
+
+	new_directory(&w, dir, strlen(dir), NULL, -1);
+
+	pthread_mutex_lock(&w.lock);
+	while (w.pending > 0)
+		pthread_cond_wait(&w.cond, &w.lock);
+	pthread_mutex_unlock(&w.lock);
+
+	free(w.path);
+	pthread_mutex_destroy(&w.lock);
+	pthread_cond_destroy(&w.cond);
+
+	return w.failed ? -1 : 0;
+}